@@ -0,0 +1,639 @@
+//  batchengine.cpp
+//     Lockstep engine for many games at once.  See batchengine.h.
+
+#include "batchengine.h"
+#include "boardkernels.h"
+#include "bitboard.h"
+#include "gamerng.h"
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+
+#if !defined(G1024_NO_SIMD) && defined(__AVX2__)
+#define BATCH_AVX2
+#include <immintrin.h>
+#elif !defined(G1024_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define BATCH_SSE2
+#include <emmintrin.h>
+#endif
+
+// The kernels' loops all have a fixed number of steps for each board size, and only
+// once they are fully unrolled do their arrays of vectors live in registers.  GCC
+// does not unroll them at -O2 without being asked.
+#if defined(__GNUC__) && !defined(__clang__)
+#define UNROLL_LANES _Pragma("GCC unroll 16")
+#else
+#define UNROLL_LANES
+#endif
+
+// Added to a game's counter for each random number, as GameRng does with 64 bits
+static const uint32_t GoldenGamma32 = 0x9E3779B9u;
+
+//-------------------------------------------------------------------------------------
+// The vector operations the kernels are written with.  A Vector holds one 32-bit
+// value for each of Width games; a mask has all bits set for the games where a
+// comparison held and none for the others.
+
+// One game at a time, for machines without vectors and for the tail of a batch
+struct ScalarLanes
+{
+	typedef int32_t Vector;
+	static const int Width = 1;
+
+	static Vector load(const int32_t *p) { return *p; }
+	static void store(int32_t *p, Vector v) { *p = v; }
+	static Vector loadBytes(const uint8_t *p) { return *p; }
+	static Vector set(int32_t x) { return x; }
+	static Vector add(Vector a, Vector b) { return (int32_t)((uint32_t)a + (uint32_t)b); }
+	static Vector subtract(Vector a, Vector b) { return (int32_t)((uint32_t)a - (uint32_t)b); }
+	static Vector multiply(Vector a, Vector b) { return (int32_t)((uint32_t)a * (uint32_t)b); }
+	template<int Bits> static Vector shiftRight(Vector a) { return (int32_t)((uint32_t)a >> Bits); }
+	static Vector bitAnd(Vector a, Vector b) { return a & b; }
+	static Vector bitOr(Vector a, Vector b) { return a | b; }
+	static Vector bitXor(Vector a, Vector b) { return a ^ b; }
+	static Vector andNot(Vector a, Vector b) { return ~a & b; }
+	static Vector equal(Vector a, Vector b) { return a == b ? -1 : 0; }
+	static Vector select(Vector mask, Vector a, Vector b) { return (mask & a) | (~mask & b); }
+	static bool any(Vector mask) { return mask != 0; }
+};
+
+#ifdef BATCH_AVX2
+// Eight games at a time
+struct Avx2Lanes
+{
+	typedef __m256i Vector;
+	static const int Width = 8;
+
+	static Vector load(const int32_t *p) { return _mm256_loadu_si256((const __m256i *)p); }
+	static void store(int32_t *p, Vector v) { _mm256_storeu_si256((__m256i *)p, v); }
+	static Vector loadBytes(const uint8_t *p) { return _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)p)); }
+	static Vector set(int32_t x) { return _mm256_set1_epi32(x); }
+	static Vector add(Vector a, Vector b) { return _mm256_add_epi32(a, b); }
+	static Vector subtract(Vector a, Vector b) { return _mm256_sub_epi32(a, b); }
+	static Vector multiply(Vector a, Vector b) { return _mm256_mullo_epi32(a, b); }
+	template<int Bits> static Vector shiftRight(Vector a) { return _mm256_srli_epi32(a, Bits); }
+	static Vector bitAnd(Vector a, Vector b) { return _mm256_and_si256(a, b); }
+	static Vector bitOr(Vector a, Vector b) { return _mm256_or_si256(a, b); }
+	static Vector bitXor(Vector a, Vector b) { return _mm256_xor_si256(a, b); }
+	static Vector andNot(Vector a, Vector b) { return _mm256_andnot_si256(a, b); }
+	static Vector equal(Vector a, Vector b) { return _mm256_cmpeq_epi32(a, b); }
+	static Vector select(Vector mask, Vector a, Vector b) { return _mm256_blendv_epi8(b, a, mask); }
+	static bool any(Vector mask) { return !_mm256_testz_si256(mask, mask); }
+};
+typedef Avx2Lanes NativeLanes;
+#endif
+
+#ifdef BATCH_SSE2
+// Four games at a time.  SSE2 has no 32-bit multiply or blend, so they are built
+// from the instructions it does have.
+struct Sse2Lanes
+{
+	typedef __m128i Vector;
+	static const int Width = 4;
+
+	static Vector load(const int32_t *p) { return _mm_loadu_si128((const __m128i *)p); }
+	static void store(int32_t *p, Vector v) { _mm_storeu_si128((__m128i *)p, v); }
+	static Vector loadBytes(const uint8_t *p)
+	{
+		int32_t bytes;
+		memcpy(&bytes, p, sizeof(bytes));
+		Vector v = _mm_cvtsi32_si128(bytes);
+		v = _mm_unpacklo_epi8(v, _mm_setzero_si128());
+		return _mm_unpacklo_epi16(v, _mm_setzero_si128());
+	}
+	static Vector set(int32_t x) { return _mm_set1_epi32(x); }
+	static Vector add(Vector a, Vector b) { return _mm_add_epi32(a, b); }
+	static Vector subtract(Vector a, Vector b) { return _mm_sub_epi32(a, b); }
+	static Vector multiply(Vector a, Vector b)
+	{
+		// Products of the even and the odd values, then the low halves put back in order
+		Vector even = _mm_mul_epu32(a, b);
+		Vector odd = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+		return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+			_mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+	}
+	template<int Bits> static Vector shiftRight(Vector a) { return _mm_srli_epi32(a, Bits); }
+	static Vector bitAnd(Vector a, Vector b) { return _mm_and_si128(a, b); }
+	static Vector bitOr(Vector a, Vector b) { return _mm_or_si128(a, b); }
+	static Vector bitXor(Vector a, Vector b) { return _mm_xor_si128(a, b); }
+	static Vector andNot(Vector a, Vector b) { return _mm_andnot_si128(a, b); }
+	static Vector equal(Vector a, Vector b) { return _mm_cmpeq_epi32(a, b); }
+	static Vector select(Vector mask, Vector a, Vector b)
+	{
+		return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+	}
+	static bool any(Vector mask) { return _mm_movemask_epi8(mask) != 0; }
+};
+typedef Sse2Lanes NativeLanes;
+#endif
+
+#if !defined(BATCH_AVX2) && !defined(BATCH_SSE2)
+typedef ScalarLanes NativeLanes;
+#endif
+
+//-------------------------------------------------------------------------------------
+// n-th random number of each game's stream: a hash of the stream's key and n, with
+// the "lowbias32" integer hash by Chris Wellons
+template<class V>
+static inline typename V::Vector randomLanes(typename V::Vector key, typename V::Vector counter)
+{
+	typedef typename V::Vector Vector;
+	Vector x = V::add(key, V::multiply(counter, V::set((int32_t)GoldenGamma32)));
+	x = V::bitXor(x, V::template shiftRight<16>(x));
+	x = V::multiply(x, V::set(0x7feb352d));
+	x = V::bitXor(x, V::template shiftRight<15>(x));
+	x = V::multiply(x, V::set((int32_t)0x846ca68bu));
+	return V::bitXor(x, V::template shiftRight<16>(x));
+}
+
+//-------------------------------------------------------------------------------------
+// Move the tiles of a line towards its first square, keeping their order, by
+// swapping every empty square with the one after it until the empties reach the end
+template<class V, int N>
+static inline void packLineLanes(typename V::Vector pieces[])
+{
+	typedef typename V::Vector Vector;
+	const Vector zero = V::set(0);
+	UNROLL_LANES
+	for (int pass = N - 1; pass > 0; pass--)
+	{
+		UNROLL_LANES
+		for (int i = 0; i < pass; i++)
+		{
+			Vector empty = V::equal(pieces[i], zero);
+			pieces[i] = V::select(empty, pieces[i + 1], pieces[i]);
+			pieces[i + 1] = V::andNot(empty, pieces[i + 1]);
+		}
+	}
+}
+
+//-------------------------------------------------------------------------------------
+// Slide a line the way slideLeft() does: pack, merge equal neighbors starting at the
+// edge, pack again.  The points scored are added to gain.  Merging two empty squares
+// leaves them empty and scores nothing, so empties need no test of their own.
+template<class V, int N>
+static inline void slideLineLanes(typename V::Vector pieces[], typename V::Vector &gain)
+{
+	typedef typename V::Vector Vector;
+	packLineLanes<V, N>(pieces);
+	UNROLL_LANES
+	for (int i = 0; i < N - 1; i++)
+	{
+		Vector merge = V::equal(pieces[i], pieces[i + 1]);
+		Vector doubled = V::add(pieces[i], pieces[i]);
+		pieces[i] = V::select(merge, doubled, pieces[i]);
+		pieces[i + 1] = V::andNot(merge, pieces[i + 1]);
+		gain = V::add(gain, V::bitAnd(merge, doubled));
+	}
+	packLineLanes<V, N>(pieces);
+}
+
+//-------------------------------------------------------------------------------------
+// One move in each of the V::Width games whose squares start at cells, square s at
+// cells[s * stride].  Line l of a game is row l when it moves left or right and
+// column l when it moves up or down, so each line is gathered in the direction of its
+// game, slid, and selected back into the row and the column.  Each game only ever
+// reads and writes its own lines, which is why the row written at line l can be
+// reloaded as part of column l.  Then every game that moved gets its new piece and
+// is checked for a move left to make.
+template<class V, int N>
+static void stepLanes(int32_t *cells, size_t stride, const uint8_t *actions, int32_t *scores,
+	const uint32_t *rngKeys, uint32_t *rngCounters, int32_t *rewards, int32_t *done, int32_t *moved)
+{
+	typedef typename V::Vector Vector;
+	const Vector zero = V::set(0);
+	const Vector allSet = V::set(-1);
+
+	// Left and right moves slide rows, up and down moves columns; right and down
+	// moves run along their lines backwards
+	Vector action = V::loadBytes(actions);
+	Vector alongRows = V::equal(V::bitAnd(action, V::set(2)), zero);
+	Vector backwards = V::equal(V::bitAnd(action, V::set(1)), V::set(1));
+
+	Vector gain = zero;
+	Vector unchanged = allSet;
+	Vector empties = zero;
+	UNROLL_LANES
+	for (int line = 0; line < N; line++)
+	{
+		Vector row[N], column[N], pieces[N], before[N];
+		UNROLL_LANES
+		for (int i = 0; i < N; i++)
+		{
+			row[i] = V::load(cells + (line * N + i) * stride);
+			column[i] = V::load(cells + (i * N + line) * stride);
+		}
+		UNROLL_LANES
+		for (int i = 0; i < N; i++)
+		{
+			before[i] = V::select(alongRows, row[i], column[i]);
+		}
+		UNROLL_LANES
+		for (int i = 0; i < N; i++)
+		{
+			pieces[i] = V::select(backwards, before[N - 1 - i], before[i]);
+		}
+		slideLineLanes<V, N>(pieces, gain);
+
+		// Back in square order, then into the row or the column
+		Vector after[N];
+		UNROLL_LANES
+		for (int i = 0; i < N; i++)
+		{
+			after[i] = V::select(backwards, pieces[N - 1 - i], pieces[i]);
+			unchanged = V::bitAnd(unchanged, V::equal(after[i], before[i]));
+			empties = V::subtract(empties, V::equal(after[i], zero));
+		}
+		UNROLL_LANES
+		for (int i = 0; i < N; i++)
+		{
+			V::store(cells + (line * N + i) * stride, V::select(alongRows, after[i], row[i]));
+		}
+		column[line] = V::load(cells + (line * N + line) * stride);
+		UNROLL_LANES
+		for (int i = 0; i < N; i++)
+		{
+			V::store(cells + (i * N + line) * stride, V::select(alongRows, column[i], after[i]));
+		}
+	}
+	Vector hasMoved = V::andNot(unchanged, allSet);
+
+	// The random number picks the piece from its low bit and, from its top 16 bits,
+	// which of the empty squares gets it.  Games that did not move get no piece.
+	Vector counter = V::add(V::load((const int32_t *)rngCounters), V::set(1));
+	V::store((int32_t *)rngCounters, counter);
+	Vector random = randomLanes<V>(V::load((const int32_t *)rngKeys), counter);
+	Vector pieceToPlace = V::add(V::set(2), V::add(V::bitAnd(random, V::set(1)), V::bitAnd(random, V::set(1))));
+
+	Vector target = V::template shiftRight<16>(V::multiply(V::template shiftRight<16>(random), empties));
+	target = V::select(hasMoved, target, allSet);
+	Vector seen = zero;
+	UNROLL_LANES
+	for (int s = 0; s < N * N; s++)
+	{
+		Vector piece = V::load(cells + s * stride);
+		Vector empty = V::equal(piece, zero);
+		V::store(cells + s * stride, V::select(V::bitAnd(empty, V::equal(seen, target)), pieceToPlace, piece));
+		seen = V::subtract(seen, empty);
+	}
+
+	// A game with an empty square left can always move.  Full boards need a pair of
+	// equal neighbors, which is only looked for when some game of the vector is full.
+	Vector full = V::equal(V::add(empties, hasMoved), zero);
+	Vector canMove = V::andNot(full, allSet);
+	if (V::any(full))
+	{
+		for (int r = 0; r < N; r++)
+		{
+			for (int c = 0; c < N; c++)
+			{
+				Vector piece = V::load(cells + (r * N + c) * stride);
+				if (c + 1 < N)
+				{
+					canMove = V::bitOr(canMove, V::equal(piece, V::load(cells + (r * N + c + 1) * stride)));
+				}
+				if (r + 1 < N)
+				{
+					canMove = V::bitOr(canMove, V::equal(piece, V::load(cells + ((r + 1) * N + c) * stride)));
+				}
+			}
+		}
+	}
+
+	V::store(scores, V::add(V::load(scores), gain));
+	V::store(rewards, gain);
+	V::store(done, V::andNot(canMove, allSet));
+	V::store(moved, hasMoved);
+}
+
+//-------------------------------------------------------------------------------------
+// Step every game of the batch, one vector of games at a time
+template<int N>
+static void stepAllLanes(int32_t *cells, size_t paddedGames, const uint8_t *actions, int32_t *scores,
+	const uint32_t *rngKeys, uint32_t *rngCounters, int numberOfGames,
+	int32_t rewards[], uint8_t done[], uint8_t moved[])
+{
+	const int Width = NativeLanes::Width;
+	int32_t laneRewards[Width], laneDone[Width], laneMoved[Width];
+	for (size_t g = 0; g < paddedGames; g += Width)
+	{
+		stepLanes<NativeLanes, N>(cells + g, paddedGames, actions + g, scores + g,
+			rngKeys + g, rngCounters + g, laneRewards, laneDone, laneMoved);
+		int lanes = std::min(Width, numberOfGames - (int)g);
+		for (int i = 0; i < lanes; i++)
+		{
+			rewards[g + i] = laneRewards[i];
+			done[g + i] = (uint8_t)(laneDone[i] & 1);
+			if (moved != NULL)
+			{
+				moved[g + i] = (uint8_t)(laneMoved[i] & 1);
+			}
+		}
+	}
+}
+
+typedef void (*StepAllLanesKernel)(int32_t *, size_t, const uint8_t *, int32_t *,
+	const uint32_t *, uint32_t *, int, int32_t[], uint8_t[], uint8_t[]);
+
+static const StepAllLanesKernel StepKernels[MaxBoardSize - MinBoardSize + 1] = {
+	stepAllLanes<4>, stepAllLanes<5>, stepAllLanes<6>, stepAllLanes<7>, stepAllLanes<8>,
+	stepAllLanes<9>, stepAllLanes<10>, stepAllLanes<11>, stepAllLanes<12>
+};
+
+//-------------------------------------------------------------------------------------
+BatchEngine::BatchEngine(int numberOfGames, int squaresPerSide, uint64_t seed)
+{
+	const int Width = NativeLanes::Width;
+	this->numberOfGames = numberOfGames;
+	this->squaresPerSide = squaresPerSide;
+	paddedGames = (numberOfGames + Width - 1) / Width * Width;
+	cells.assign((size_t)squaresPerSide * squaresPerSide * paddedGames, 0);
+	scores.assign(paddedGames, 0);
+	rngKeys.assign(paddedGames, 0);
+	rngCounters.assign(paddedGames, 0);
+	paddedActions.assign(paddedGames, 0);
+
+	// Each game's key comes from the game's normal stream, so batches with the same
+	// seed play the same games
+	for (int g = 0; g < paddedGames; g++)
+	{
+		GameRng rng(seed, g);
+		rngKeys[g] = (uint32_t)rng.next();
+	}
+	resetAll();
+}
+
+//-------------------------------------------------------------------------------------
+// Start game over with two random pieces.  Its random stream carries on from where
+// it was, so the new game is not a repeat of the old one.
+void BatchEngine::reset(int game)
+{
+	int squares = squaresPerSide * squaresPerSide;
+	for (int s = 0; s < squares; s++)
+	{
+		cells[(size_t)s * paddedGames + game] = 0;
+	}
+	scores[game] = 0;
+
+	// The same choice of piece and square as stepLanes() makes
+	for (int p = 0; p < 2; p++)
+	{
+		uint32_t random = (uint32_t)randomLanes<ScalarLanes>((int32_t)rngKeys[game], (int32_t)++rngCounters[game]);
+		uint32_t target = ((random >> 16) * (uint32_t)(squares - p)) >> 16;
+		uint32_t seen = 0;
+		for (int s = 0; s < squares; s++)
+		{
+			int32_t &piece = cells[(size_t)s * paddedGames + game];
+			if (piece == 0 && seen++ == target)
+			{
+				piece = 2 + 2 * (random & 1);
+			}
+		}
+	}
+}
+
+//-------------------------------------------------------------------------------------
+void BatchEngine::resetAll()
+{
+	for (int g = 0; g < paddedGames; g++)
+	{
+		reset(g);
+	}
+}
+
+//-------------------------------------------------------------------------------------
+// Make one move in every game: actions[g] is the Direction for game g.  A move that
+// does not change its board leaves the game as it was and places no piece.  Fills in,
+// for every game, the points the move scored, whether the game is now over (no
+// direction would change the board), and, if moved is given, whether the board
+// changed.  Games that are over stay as they are until reset().
+void BatchEngine::step(const uint8_t actions[], int32_t rewards[], uint8_t done[], uint8_t moved[])
+{
+	memcpy(&paddedActions[0], actions, numberOfGames);
+	StepKernels[squaresPerSide - MinBoardSize](&cells[0], paddedGames, &paddedActions[0], &scores[0],
+		&rngKeys[0], &rngCounters[0], numberOfGames, rewards, done, moved);
+}
+
+//-------------------------------------------------------------------------------------
+void BatchEngine::getBoard(int game, int board[]) const
+{
+	for (int s = 0; s < squaresPerSide * squaresPerSide; s++)
+	{
+		board[s] = cells[(size_t)s * paddedGames + game];
+	}
+}
+
+//-------------------------------------------------------------------------------------
+void BatchEngine::setBoard(int game, const int board[])
+{
+	for (int s = 0; s < squaresPerSide * squaresPerSide; s++)
+	{
+		cells[(size_t)s * paddedGames + game] = board[s];
+	}
+}
+
+//-------------------------------------------------------------------------------------
+// Name of the vector instructions the engine was built with
+const char *BatchEngine::instructionSet()
+{
+#if defined(BATCH_AVX2)
+	return "avx2";
+#elif defined(BATCH_SSE2)
+	return "sse2";
+#else
+	return "scalar";
+#endif
+}
+
+//-------------------------------------------------------------------------------------
+// Step a batch of random games and check every move against slideBoard(): a game
+// that could not move must be unchanged, and any other must match the reference
+// slide but for one new 2 or 4 on an empty square, with the same points scored.
+// Returns the number of moves that did not match.
+static int64_t countReferenceMismatches(int squaresPerSide, uint64_t seed, int numberOfGames, int steps)
+{
+	initializeBitboardTables();
+	BatchEngine engine(numberOfGames, squaresPerSide, seed);
+	GameRng rng(seed, 0);
+	int squares = squaresPerSide * squaresPerSide;
+	std::vector<uint8_t> actions(numberOfGames), done(numberOfGames), moved(numberOfGames);
+	std::vector<int32_t> rewards(numberOfGames);
+	std::vector<int> before((size_t)numberOfGames * squares);
+	int board[MaxBoardSize * MaxBoardSize], after[MaxBoardSize * MaxBoardSize];
+	int64_t mismatches = 0;
+
+	for (int step = 0; step < steps; step++)
+	{
+		for (int g = 0; g < numberOfGames; g++)
+		{
+			actions[g] = (uint8_t)rng.nextBelow(NumberOfDirections);
+			engine.getBoard(g, &before[(size_t)g * squares]);
+		}
+		engine.step(&actions[0], &rewards[0], &done[0], &moved[0]);
+		for (int g = 0; g < numberOfGames; g++)
+		{
+			copyBoard(&before[(size_t)g * squares], board, squaresPerSide);
+			int score = 0;
+			bool changed = slideBoard(board, squaresPerSide, (Direction)actions[g], score);
+			engine.getBoard(g, after);
+			int placed = 0;
+			bool bad = (changed != (moved[g] != 0)) || rewards[g] != score;
+			for (int s = 0; s < squares; s++)
+			{
+				if (after[s] != board[s])
+				{
+					placed++;
+					bad = bad || board[s] != 0 || (after[s] != 2 && after[s] != 4);
+				}
+			}
+			bad = bad || placed != (changed ? 1 : 0) || (done[g] != 0) == hasLegalMove(after, squaresPerSide);
+			if (bad)
+			{
+				mismatches++;
+			}
+			if (done[g])
+			{
+				engine.reset(g);
+			}
+		}
+	}
+	return mismatches;
+}
+
+//-------------------------------------------------------------------------------------
+// Worker thread: step its own engine through the given number of steps, starting
+// over every game that ends, with random moves from a table made up front so that
+// choosing them costs next to nothing
+static void runLockstepGames(int numberOfGames, int squaresPerSide, uint64_t seed, int firstGame,
+	int steps, int64_t &gamesFinished, int64_t &totalScore)
+{
+	const int ActionRows = 64;
+	BatchEngine engine(numberOfGames, squaresPerSide, seed + firstGame);
+	GameRng rng(seed, firstGame);
+	std::vector<uint8_t> actions((size_t)ActionRows * numberOfGames);
+	for (size_t i = 0; i < actions.size(); i++)
+	{
+		actions[i] = (uint8_t)rng.nextBelow(NumberOfDirections);
+	}
+	std::vector<int32_t> rewards(numberOfGames);
+	std::vector<uint8_t> done(numberOfGames);
+
+	gamesFinished = 0;
+	totalScore = 0;
+	for (int step = 0; step < steps; step++)
+	{
+		engine.step(&actions[(size_t)(step % ActionRows) * numberOfGames], &rewards[0], &done[0]);
+		for (int g = 0; g < numberOfGames; g++)
+		{
+			if (done[g])
+			{
+				gamesFinished++;
+				totalScore += engine.getScore(g);
+				engine.reset(g);
+			}
+		}
+	}
+}
+
+//-------------------------------------------------------------------------------------
+static void displayLockstepUsage()
+{
+	std::cout << "Usage: 1024 --lockstep [--games B] [--size S] [--steps K] [--seed X] [--threads T]\n";
+}
+
+//-------------------------------------------------------------------------------------
+// Handle "--lockstep" on the command line: time random games played in lockstep,
+// then check a smaller batch against the normal slides.  Returns the program's exit
+// status.
+int runLockstepCommand(int argc, char *argv[])
+{
+	int numberOfGames = 4096;
+	int squaresPerSide = 4;
+	int steps = 1000;
+	uint64_t seed = 1;
+	int numberOfThreads = 0;
+
+	for (int i = 2; i < argc; i++)
+	{
+		const char *option = argv[i];
+		const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+		if (value == NULL)
+		{
+			displayLockstepUsage();
+			return 1;
+		}
+		if (strcmp(option, "--games") == 0) {
+			numberOfGames = atoi(value);
+		}
+		else if (strcmp(option, "--size") == 0) {
+			squaresPerSide = atoi(value);
+		}
+		else if (strcmp(option, "--steps") == 0) {
+			steps = atoi(value);
+		}
+		else if (strcmp(option, "--seed") == 0) {
+			seed = strtoull(value, NULL, 10);
+		}
+		else if (strcmp(option, "--threads") == 0) {
+			numberOfThreads = atoi(value);
+		}
+		else {
+			displayLockstepUsage();
+			return 1;
+		}
+		i++;   // Skip over the value
+	}
+	if (numberOfThreads <= 0)
+	{
+		numberOfThreads = std::max(1u, std::thread::hardware_concurrency());
+	}
+	numberOfThreads = std::min(numberOfThreads, numberOfGames);
+	if (numberOfGames < 1 || steps < 1
+		|| squaresPerSide < MinBoardSize || squaresPerSide > MaxBoardSize)
+	{
+		displayLockstepUsage();
+		return 1;
+	}
+
+	// Each thread gets an engine with its share of the games
+	std::vector<int64_t> gamesFinished(numberOfThreads, 0), totalScores(numberOfThreads, 0);
+	std::vector<std::thread> workers;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	int firstGame = 0;
+	for (int t = 0; t < numberOfThreads; t++)
+	{
+		int games = numberOfGames / numberOfThreads + (t < numberOfGames % numberOfThreads ? 1 : 0);
+		workers.push_back(std::thread(runLockstepGames, games, squaresPerSide, seed, firstGame, steps,
+			std::ref(gamesFinished[t]), std::ref(totalScores[t])));
+		firstGame += games;
+	}
+	int64_t finished = 0;
+	int64_t totalScore = 0;
+	for (int t = 0; t < numberOfThreads; t++)
+	{
+		workers[t].join();
+		finished += gamesFinished[t];
+		totalScore += totalScores[t];
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	int64_t mismatches = countReferenceMismatches(squaresPerSide, seed, 256, 2000);
+
+	std::cout << std::fixed << std::setprecision(1)
+		<< "games: " << numberOfGames << "\n"
+		<< "board: " << squaresPerSide << "x" << squaresPerSide << "\n"
+		<< "threads: " << numberOfThreads << "\n"
+		<< "instruction_set: " << BatchEngine::instructionSet() << "\n"
+		<< "steps: " << steps << "\n"
+		<< "seconds: " << std::setprecision(3) << elapsed.count() << "\n"
+		<< std::setprecision(1)
+		<< "board_steps_per_sec: " << (double)numberOfGames * steps / elapsed.count() << "\n"
+		<< "games_finished: " << finished << "\n"
+		<< "score_mean: " << (finished > 0 ? (double)totalScore / finished : 0.0) << "\n"
+		<< "reference_mismatches: " << mismatches << "\n";
+	return mismatches == 0 ? 0 : 1;
+}
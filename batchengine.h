@@ -0,0 +1,62 @@
+//  batchengine.h
+//     Lockstep engine for many games at once, for training players that learn from
+//     huge numbers of moves.  step() makes one move in every game of the batch, each
+//     game with its own direction.
+//
+//     The boards are kept as a structure of arrays: square s of game g is
+//     cells[s * paddedGames + g], so the same square of neighboring games sits side
+//     by side in memory and a whole vector of games is loaded with one instruction.
+//     The move kernel is written once against a small set of vector operations and
+//     built for AVX2 (8 games per instruction) when the compiler targets it (-mavx2,
+//     /arch:AVX2), otherwise for SSE2 (4 games), with a plain one-game-at-a-time
+//     version where neither exists or when G1024_NO_SIMD is defined.
+//
+//     Every game of a vector may move in a different direction, so each line is
+//     gathered in the game's own direction with selects, slid and merged with the
+//     same steps for every game (pack, merge neighbors from the edge, pack again, as
+//     slideLeft() does), and selected back into place.  New pieces come from a 32-bit
+//     counter-based generator, one stream per game, and go on the k-th empty square
+//     of the board for a random k, so the whole step runs without a branch per game.
+//
+//     Started from the command line with:
+//        1024 --lockstep [--games B] [--size S] [--steps K] [--seed X]
+
+#ifndef BATCHENGINE_H
+#define BATCHENGINE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+class BatchEngine
+{
+public:
+	BatchEngine(int numberOfGames, int squaresPerSide, uint64_t seed);
+
+	void reset(int game);
+	void resetAll();
+	void step(const uint8_t actions[], int32_t rewards[], uint8_t done[], uint8_t moved[] = 0);
+
+	int getNumberOfGames() const { return numberOfGames; }
+	int getSquaresPerSide() const { return squaresPerSide; }
+	int getCell(int game, int square) const { return cells[(size_t)square * paddedGames + game]; }
+	void getBoard(int game, int board[]) const;
+	void setBoard(int game, const int board[]);
+	int getScore(int game) const { return scores[game]; }
+
+	static const char *instructionSet();
+
+private:
+	int numberOfGames;
+	int paddedGames;                  // numberOfGames rounded up to whole vectors
+	int squaresPerSide;
+	std::vector<int32_t> cells;       // Square s of game g at cells[s * paddedGames + g]
+	std::vector<int32_t> scores;
+	std::vector<uint32_t> rngKeys;    // Each game's random stream
+	std::vector<uint32_t> rngCounters;
+	std::vector<uint8_t> paddedActions;   // Actions, copied out to paddedGames entries
+};
+
+int runLockstepCommand(int argc, char *argv[]);
+
+#endif // BATCHENGINE_H
@@ -0,0 +1,303 @@
+//  bench.cpp
+//     Microbenchmarks for the move kernels.  This is a program of its own, built from
+//     the engine's files in place of main.cpp.
+//
+//     For every board size from MinBoardSize to MaxBoardSize and each of a range of
+//     fill densities, it makes a set of random boards and times, over all of them:
+//
+//        slideLeft ... slideDown      the reference slides in board.cpp
+//        kernelLeft ... kernelDown    slideBoard(), the size-specialized kernels and,
+//                                     on 4x4 boards, the packed tables
+//        linesLeft ... linesDown      the size-specialized kernels alone
+//        bitboardLeft ... Down        the packed 4x4 kernels, on already packed boards
+//        slideAll                     all four moves in one pass, per move made
+//        hasLegalMove                 whether any move is left
+//        placeRandomPiece             placing a piece, then taking it off again
+//        copyBoard                    copying the board
+//        ntupleEvaluate               evaluating a packed board with an n-tuple
+//                                     network (ntuple.h), per evaluation
+//
+//     The slides change the board they are given, so each one is timed on a fresh
+//     copy, and the time copyBoard takes at that size and density is subtracted.
+//     Results are one comma-separated line per kernel, size and density:
+//        kernel,size,density,ns_per_move,moves_per_sec
+//
+//     Run with:
+//        bench [--millis M] [--seed X]
+//     where M is roughly how long each kernel is run for at each size and density.
+
+#include "board.h"
+#include "boardkernels.h"
+#include "bitboard.h"
+#include "emptycells.h"
+#include "gamerng.h"
+#include "ntuple.h"
+#include <iostream>
+#include <iomanip>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+
+typedef std::chrono::steady_clock Clock;
+
+const int BoardsPerSet = 1024;    // Random boards each kernel is run over, again and again
+const int Densities[] = { 25, 50, 75, 100 };   // Percent of the squares with a tile
+const int NumberOfDensities = sizeof(Densities) / sizeof(Densities[0]);
+
+// Keeps the results of the kernels alive, so the compiler cannot drop the work
+static volatile int sink;
+
+// Network for ntupleEvaluate.  Its weights are all 0, which takes the same lookups
+// as a trained network's.
+static NTupleNetwork network;
+
+// Size-specialized kernels, as boardkernels.cpp dispatches them
+typedef bool (*SlideKernel)(int board[], int &score, EmptyCells *emptyCells, int *maxTile);
+
+#define BOARD_KERNELS(N) \
+	{ slideBoardKernel<N, DirectionLeft>, slideBoardKernel<N, DirectionRight>, \
+	  slideBoardKernel<N, DirectionUp>, slideBoardKernel<N, DirectionDown> }
+
+static const SlideKernel LineKernels[MaxBoardSize - MinBoardSize + 1][NumberOfDirections] = {
+	BOARD_KERNELS(4), BOARD_KERNELS(5), BOARD_KERNELS(6),
+	BOARD_KERNELS(7), BOARD_KERNELS(8), BOARD_KERNELS(9),
+	BOARD_KERNELS(10), BOARD_KERNELS(11), BOARD_KERNELS(12)
+};
+
+#undef BOARD_KERNELS
+
+static const char *DirectionNames[NumberOfDirections] = { "Left", "Right", "Up", "Down" };
+
+// The boards one size and density are timed on
+struct BoardSet
+{
+	int squaresPerSide;
+	int density;
+	std::vector<int> boards;          // BoardsPerSet boards, one after another
+	std::vector<Bitboard> packed;     // The ones that pack, for 4x4 boards
+
+	const int *board(int b) const { return &boards[(size_t)b * squaresPerSide * squaresPerSide]; }
+};
+
+
+//-------------------------------------------------------------------------------------
+// Make BoardsPerSet random boards with the given percent of their squares filled,
+// with tiles from 2 to 1024
+static void makeBoardSet(BoardSet &set, int squaresPerSide, int density, GameRng &rng)
+{
+	int squares = squaresPerSide * squaresPerSide;
+	set.squaresPerSide = squaresPerSide;
+	set.density = density;
+	set.boards.assign((size_t)BoardsPerSet * squares, 0);
+	set.packed.clear();
+	for (int b = 0; b < BoardsPerSet; b++)
+	{
+		int *board = &set.boards[(size_t)b * squares];
+		for (int i = 0; i < squares; i++)
+		{
+			if ((int)rng.nextBelow(100) < density)
+			{
+				board[i] = 2 << rng.nextBelow(10);
+			}
+		}
+		Bitboard packed;
+		if (squaresPerSide == BitboardSide && packBoard(board, packed))
+		{
+			set.packed.push_back(packed);
+		}
+	}
+}
+
+//-------------------------------------------------------------------------------------
+// Run one kernel over the whole set until about millis milliseconds have passed.
+// Kernel is called as kernel(b) for board b and returns a value to keep.  Returns
+// the nanoseconds per call.
+template<class Kernel>
+double timeKernel(Kernel kernel, int numberOfBoards, int millis)
+{
+	int64_t calls = 0;
+	int kept = 0;
+	Clock::time_point start = Clock::now();
+	Clock::time_point deadline = start + std::chrono::milliseconds(millis);
+	Clock::time_point now;
+	do
+	{
+		for (int b = 0; b < numberOfBoards; b++)
+		{
+			kept += kernel(b);
+		}
+		calls += numberOfBoards;
+		now = Clock::now();
+	} while (now < deadline);
+	sink = kept;
+	return std::chrono::duration<double, std::nano>(now - start).count() / calls;
+}
+
+//-------------------------------------------------------------------------------------
+// Print one result line
+static void report(const char *kernel, const BoardSet &set, double nanoseconds)
+{
+	nanoseconds = std::max(nanoseconds, 0.001);   // Net of copying, the time can be all but nothing
+	std::cout << kernel << "," << set.squaresPerSide << "," << std::setprecision(2) << set.density / 100.0
+		<< "," << std::setprecision(2) << nanoseconds
+		<< "," << std::setprecision(0) << 1e9 / nanoseconds << "\n";
+}
+
+//-------------------------------------------------------------------------------------
+// Time every kernel on one set of boards
+static void benchBoardSet(const BoardSet &set, int millis)
+{
+	int squaresPerSide = set.squaresPerSide;
+	int squares = squaresPerSide * squaresPerSide;
+	int work[MaxBoardSize * MaxBoardSize];
+	char name[40];
+
+	double copy = timeKernel([&](int b) {
+		copyBoard(set.board(b), work, squaresPerSide);
+		return work[0];
+	}, BoardsPerSet, millis);
+	report("copyBoard", set, copy);
+
+	for (int d = 0; d < NumberOfDirections; d++)
+	{
+		Direction direction = (Direction)d;
+		sprintf(name, "slide%s", DirectionNames[d]);
+		report(name, set, timeKernel([&](int b) {
+			copyBoard(set.board(b), work, squaresPerSide);
+			int score = 0;
+			switch (direction) {
+			case DirectionLeft:  slideLeft(work, squaresPerSide, score);  break;
+			case DirectionRight: slideRight(work, squaresPerSide, score); break;
+			case DirectionUp:    slideUp(work, squaresPerSide, score);    break;
+			case DirectionDown:  slideDown(work, squaresPerSide, score);  break;
+			}
+			return score + work[0];
+		}, BoardsPerSet, millis) - copy);
+
+		sprintf(name, "kernel%s", DirectionNames[d]);
+		report(name, set, timeKernel([&](int b) {
+			copyBoard(set.board(b), work, squaresPerSide);
+			int score = 0;
+			return (int)slideBoard(work, squaresPerSide, direction, score) + score + work[0];
+		}, BoardsPerSet, millis) - copy);
+
+		SlideKernel lines = LineKernels[squaresPerSide - MinBoardSize][d];
+		sprintf(name, "lines%s", DirectionNames[d]);
+		report(name, set, timeKernel([&](int b) {
+			copyBoard(set.board(b), work, squaresPerSide);
+			int score = 0;
+			return (int)lines(work, score, NULL, NULL) + score + work[0];
+		}, BoardsPerSet, millis) - copy);
+
+		if (!set.packed.empty())
+		{
+			const std::vector<Bitboard> &packed = set.packed;
+			sprintf(name, "bitboard%s", DirectionNames[d]);
+			report(name, set, timeKernel([&](int b) {
+				int score = 0;
+				Bitboard result = packed[b];
+				switch (direction) {
+				case DirectionLeft:  result = bitboardSlideLeft(packed[b], score);  break;
+				case DirectionRight: result = bitboardSlideRight(packed[b], score); break;
+				case DirectionUp:    result = bitboardSlideUp(packed[b], score);    break;
+				case DirectionDown:  result = bitboardSlideDown(packed[b], score);  break;
+				}
+				return (int)result + score;
+			}, (int)packed.size(), millis));
+		}
+	}
+
+	if (!set.packed.empty())
+	{
+		const std::vector<Bitboard> &packed = set.packed;
+		report("ntupleEvaluate", set, timeKernel([&](int b) {
+			return (int)network.evaluate(packed[b]);
+		}, (int)packed.size(), millis));
+	}
+
+	AllMoves moves;
+	report("slideAll", set, timeKernel([&](int b) {
+		slideAllDirections(set.board(b), squaresPerSide, moves);
+		return moves.gains[0] + moves.boards[DirectionDown][0];
+	}, BoardsPerSet, millis) / NumberOfDirections);
+
+	report("hasLegalMove", set, timeKernel([&](int b) {
+		return (int)hasLegalMove(set.board(b), squaresPerSide);
+	}, BoardsPerSet, millis));
+
+	// Every board gets its open squares once; each timed call places a piece and takes
+	// it off again, so the board and its open squares are as they were for the next call
+	std::vector<int> boards(set.boards);
+	std::vector<EmptyCells> emptyCells(BoardsPerSet);
+	for (int b = 0; b < BoardsPerSet; b++)
+	{
+		emptyCells[b].reset(&boards[(size_t)b * squares], squaresPerSide);
+	}
+	GameRng rng(set.density, squaresPerSide);
+	report("placeRandomPiece", set, timeKernel([&](int b) {
+		int *board = &boards[(size_t)b * squares];
+		int square = placeRandomPiece(board, emptyCells[b], rng);
+		if (square >= 0)
+		{
+			board[square] = 0;
+			emptyCells[b].setEmpty(square);
+		}
+		return square;
+	}, BoardsPerSet, millis));
+}
+
+//-------------------------------------------------------------------------------------
+static void displayUsage()
+{
+	std::cout << "Usage: bench [--millis M] [--seed X]\n";
+}
+
+//-------------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+	int millis = 50;
+	uint64_t seed = 1;
+	for (int i = 1; i < argc; i++)
+	{
+		const char *option = argv[i];
+		const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+		if (value == NULL)
+		{
+			displayUsage();
+			return 1;
+		}
+		if (strcmp(option, "--millis") == 0) {
+			millis = atoi(value);
+		}
+		else if (strcmp(option, "--seed") == 0) {
+			seed = strtoull(value, NULL, 10);
+		}
+		else {
+			displayUsage();
+			return 1;
+		}
+		i++;   // Skip over the value
+	}
+	if (millis < 1)
+	{
+		displayUsage();
+		return 1;
+	}
+
+	initializeBitboardTables();
+	GameRng rng(seed, 0);
+	std::cout << std::fixed << "kernel,size,density,ns_per_move,moves_per_sec\n";
+	for (int size = MinBoardSize; size <= MaxBoardSize; size++)
+	{
+		for (int k = 0; k < NumberOfDensities; k++)
+		{
+			BoardSet set;
+			makeBoardSet(set, size, Densities[k], rng);
+			benchBoardSet(set, millis);
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,520 @@
+//  bigboard.cpp
+//     Boards of any size.  See bigboard.h.
+
+#include "bigboard.h"
+#include "threadpool.h"
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+#include <algorithm>
+
+// Tasks a move is split into for each thread of the pool, so a thread that finishes
+// its share early can steal some of another's
+static const int TasksPerThread = 4;
+
+
+//-------------------------------------------------------------------------------------
+// An empty board with squaresPerSide squares per side, whose pieces will come from
+// the stream for game gameIndex of the given seed
+BigBoard::BigBoard(int squaresPerSide, uint64_t seed, uint64_t gameIndex)
+	: squaresPerSide(squaresPerSide), score(0), rng(seed, gameIndex)
+{
+	stride = (squaresPerSide + CacheLineSquares - 1) / CacheLineSquares * CacheLineSquares;
+
+	// One cache line more than the squares need, so they can start on a line boundary
+	storage.assign((size_t)squaresPerSide * stride + CacheLineSquares, 0);
+	uintptr_t address = (uintptr_t)storage.data();
+	uintptr_t lineBytes = CacheLineSquares * sizeof(uint64_t);
+	cells = storage.data() + (lineBytes - address % lineBytes) % lineBytes / sizeof(uint64_t);
+
+	emptyPerLine.assign(squaresPerSide, 0);
+	countEmptyByRows();
+}
+
+//-------------------------------------------------------------------------------------
+// Empty every square and set the score back to 0
+void BigBoard::clear()
+{
+	std::fill(storage.begin(), storage.end(), 0);
+	score = 0;
+	countEmptyByRows();
+}
+
+//-------------------------------------------------------------------------------------
+void BigBoard::countEmptyByRows()
+{
+	emptyByStrips = false;
+	for (int r = 0; r < squaresPerSide; r++)
+	{
+		int64_t empty = 0;
+		const uint64_t *line = row(r);
+		for (int c = 0; c < squaresPerSide; c++)
+		{
+			empty += (line[c] == 0);
+		}
+		emptyPerLine[r] = empty;
+	}
+}
+
+//-------------------------------------------------------------------------------------
+int64_t BigBoard::countEmpty() const
+{
+	int64_t empty = 0;
+	for (size_t i = 0; i < emptyPerLine.size(); i++)
+	{
+		empty += emptyPerLine[i];
+	}
+	return empty;
+}
+
+//-------------------------------------------------------------------------------------
+// Put a piece of any value on a square
+void BigBoard::set(int r, int c, uint64_t value)
+{
+	uint64_t &square = row(r)[c];
+	int line = emptyByStrips ? c / ColumnBlock : r;
+	emptyPerLine[line] += (int64_t)(value == 0) - (int64_t)(square == 0);
+	square = value;
+}
+
+//-------------------------------------------------------------------------------------
+// Slide rows firstRow to endRow - 1 left, or right if backwards.  Each row is merged in
+// one pass: a tile waits as pending until the next tile shows whether the two merge,
+// the same pairing from the edge as slideLeft() makes, and is then written to the
+// next square from the edge.  Squares are only ever written behind the one being
+// read, so the row is slid in place.
+BigBoard::SlideTotals BigBoard::slideRows(int firstRow, int endRow, bool backwards)
+{
+	SlideTotals totals = { 0, false };
+	int n = squaresPerSide;
+	for (int r = firstRow; r < endRow; r++)
+	{
+		uint64_t *line = row(r);
+		if (backwards)
+		{
+			line += n - 1;
+		}
+		ptrdiff_t step = backwards ? -1 : 1;
+
+		uint64_t pending = 0;
+		int write = 0;
+		for (int read = 0; read < n; read++)
+		{
+			uint64_t value = line[read * step];
+			if (value == 0)
+			{
+				continue;
+			}
+			if (value == pending)
+			{
+				value += value;
+				totals.gain += value;
+				pending = 0;
+			}
+			else
+			{
+				std::swap(value, pending);
+				if (value == 0)
+				{
+					continue;   // The first tile of the row, or the first after a merge
+				}
+			}
+			totals.changed |= (line[write * step] != value);
+			line[write * step] = value;
+			write++;
+		}
+		if (pending != 0)
+		{
+			totals.changed |= (line[write * step] != pending);
+			line[write * step] = pending;
+			write++;
+		}
+		emptyPerLine[r] = n - write;
+		for (; write < n; write++)
+		{
+			totals.changed |= (line[write * step] != 0);
+			line[write * step] = 0;
+		}
+	}
+	return totals;
+}
+
+//-------------------------------------------------------------------------------------
+// Slide strips firstStrip to endStrip - 1 of ColumnBlock columns up, or down if
+// backwards.  Every column of a strip is merged as slideRows() merges a row, but the
+// strip's columns are stepped down together a row at a time, so each step reads one
+// cache line instead of one square from each of ColumnBlock rows.
+BigBoard::SlideTotals BigBoard::slideStrips(int firstStrip, int endStrip, bool backwards)
+{
+	SlideTotals totals = { 0, false };
+	int n = squaresPerSide;
+	ptrdiff_t step = backwards ? -(ptrdiff_t)stride : (ptrdiff_t)stride;
+	for (int strip = firstStrip; strip < endStrip; strip++)
+	{
+		int firstColumn = strip * ColumnBlock;
+		int width = std::min(ColumnBlock, n - firstColumn);
+		uint64_t *edge = cells + (backwards ? (size_t)(n - 1) * stride : 0) + firstColumn;
+
+		uint64_t pending[ColumnBlock] = { 0 };
+		int write[ColumnBlock] = { 0 };
+		for (int read = 0; read < n; read++)
+		{
+			const uint64_t *line = edge + read * step;
+			for (int c = 0; c < width; c++)
+			{
+				uint64_t value = line[c];
+				if (value == 0)
+				{
+					continue;
+				}
+				if (value == pending[c])
+				{
+					value += value;
+					totals.gain += value;
+					pending[c] = 0;
+				}
+				else
+				{
+					std::swap(value, pending[c]);
+					if (value == 0)
+					{
+						continue;
+					}
+				}
+				uint64_t &square = edge[write[c] * step + c];
+				totals.changed |= (square != value);
+				square = value;
+				write[c]++;
+			}
+		}
+
+		// Write the last tiles, then empty every square past them, again a row at a time
+		int fewest = n;
+		int64_t empty = 0;
+		for (int c = 0; c < width; c++)
+		{
+			if (pending[c] != 0)
+			{
+				uint64_t &square = edge[write[c] * step + c];
+				totals.changed |= (square != pending[c]);
+				square = pending[c];
+				write[c]++;
+			}
+			fewest = std::min(fewest, write[c]);
+			empty += n - write[c];
+		}
+		emptyPerLine[strip] = empty;
+		for (int position = fewest; position < n; position++)
+		{
+			uint64_t *line = edge + position * step;
+			for (int c = 0; c < width; c++)
+			{
+				if (position >= write[c])
+				{
+					totals.changed |= (line[c] != 0);
+					line[c] = 0;
+				}
+			}
+		}
+	}
+	return totals;
+}
+
+//-------------------------------------------------------------------------------------
+// Slide the pieces in the given direction, adding the merged tiles to the score.
+// Returns true if the move changed the board.  With a pool and a board of at least
+// ParallelSide squares per side the lines are split among the pool's threads.
+bool BigBoard::slide(Direction direction, WorkStealingPool *pool)
+{
+	bool backwards = (direction == DirectionRight || direction == DirectionDown);
+	bool vertical = (direction == DirectionUp || direction == DirectionDown);
+	int lines = vertical ? (squaresPerSide + ColumnBlock - 1) / ColumnBlock : squaresPerSide;
+	if (vertical != emptyByStrips)
+	{
+		std::fill(emptyPerLine.begin(), emptyPerLine.end(), 0);
+		emptyByStrips = vertical;
+	}
+
+	int numberOfTasks = 1;
+	if (pool != NULL && squaresPerSide >= ParallelSide)
+	{
+		numberOfTasks = std::min(lines, pool->getNumberOfThreads() * TasksPerThread);
+	}
+	std::vector<SlideTotals> totals(numberOfTasks);
+	if (numberOfTasks == 1)
+	{
+		totals[0] = vertical ? slideStrips(0, lines, backwards) : slideRows(0, lines, backwards);
+	}
+	else
+	{
+		TaskGroup group(*pool);
+		for (int t = 0; t < numberOfTasks; t++)
+		{
+			int first = (int)((int64_t)lines * t / numberOfTasks);
+			int end = (int)((int64_t)lines * (t + 1) / numberOfTasks);
+			SlideTotals &taskTotals = totals[t];
+			group.run([this, first, end, vertical, backwards, &taskTotals]() {
+				taskTotals = vertical ? slideStrips(first, end, backwards) : slideRows(first, end, backwards);
+			});
+		}
+		group.wait();
+	}
+
+	bool changed = false;
+	for (int t = 0; t < numberOfTasks; t++)
+	{
+		score += totals[t].gain;
+		changed |= totals[t].changed;
+	}
+	return changed;
+}
+
+//-------------------------------------------------------------------------------------
+// Place a 2 or a 4 on a random empty square.  The counts of empty squares per line
+// lead straight to the line holding it, so only that line is searched.  Returns false
+// if the board is full.
+bool BigBoard::placeRandomPiece()
+{
+	int64_t empty = countEmpty();
+	if (empty == 0)
+	{
+		return false;
+	}
+	uint64_t piece = (rng.nextBelow(2) == 1) ? 4 : 2;
+	int64_t k = (int64_t)(rng.next() % (uint64_t)empty);   // Boards may have more than 2^32 squares
+
+	int line = 0;
+	while (k >= emptyPerLine[line])
+	{
+		k -= emptyPerLine[line];
+		line++;
+	}
+	emptyPerLine[line]--;
+
+	if (!emptyByStrips)
+	{
+		uint64_t *squares = row(line);
+		for (int c = 0; ; c++)
+		{
+			if (squares[c] == 0 && k-- == 0)
+			{
+				squares[c] = piece;
+				return true;
+			}
+		}
+	}
+	int firstColumn = line * ColumnBlock;
+	int width = std::min(ColumnBlock, squaresPerSide - firstColumn);
+	for (int r = 0; ; r++)
+	{
+		uint64_t *squares = row(r) + firstColumn;
+		for (int c = 0; c < width; c++)
+		{
+			if (squares[c] == 0 && k-- == 0)
+			{
+				squares[c] = piece;
+				return true;
+			}
+		}
+	}
+}
+
+//-------------------------------------------------------------------------------------
+// Slide the pieces and, if that changed the board, place a new random piece.
+// Returns false, leaving the board unchanged, if the move did not change it.
+bool BigBoard::makeMove(Direction direction, WorkStealingPool *pool)
+{
+	if (!slide(direction, pool))
+	{
+		return false;
+	}
+	placeRandomPiece();
+	return true;
+}
+
+
+//-------------------------------------------------------------------------------------
+// Slide a board kept row by row in a plain vector, one line at a time, with the pack,
+// merge and pack again of slideLeft().  The check the big board's slides are held to.
+static void referenceSlide(std::vector<uint64_t> &squares, int n, Direction direction, uint64_t &score)
+{
+	std::vector<uint64_t> tiles(n);
+	for (int line = 0; line < n; line++)
+	{
+		// Index of square p of the line, counting from the edge the tiles slide towards
+		size_t first;
+		ptrdiff_t step;
+		switch (direction) {
+		case DirectionLeft:  first = (size_t)line * n;           step = 1;  break;
+		case DirectionRight: first = (size_t)line * n + n - 1;   step = -1; break;
+		case DirectionUp:    first = line;                       step = n;  break;
+		default:             first = (size_t)(n - 1) * n + line; step = -n; break;
+		}
+		int count = 0;
+		for (int p = 0; p < n; p++)
+		{
+			uint64_t value = squares[first + p * step];
+			if (value != 0)
+			{
+				tiles[count++] = value;
+			}
+		}
+		int write = 0;
+		for (int read = 0; read < count; read++, write++)
+		{
+			uint64_t value = tiles[read];
+			if (read + 1 < count && tiles[read + 1] == value)
+			{
+				value += value;
+				score += value;
+				read++;
+			}
+			squares[first + write * step] = value;
+		}
+		for (; write < n; write++)
+		{
+			squares[first + write * step] = 0;
+		}
+	}
+}
+
+//-------------------------------------------------------------------------------------
+// Fill about half the squares with small random tiles, so the moves have work to do
+static void fillRandomly(BigBoard &board, GameRng &rng)
+{
+	int n = board.getSquaresPerSide();
+	for (int r = 0; r < n; r++)
+	{
+		for (int c = 0; c < n; c++)
+		{
+			uint32_t draw = rng.nextBelow(8);
+			board.set(r, c, draw < 4 ? 0 : (uint64_t)2 << (draw - 4));
+		}
+	}
+}
+
+//-------------------------------------------------------------------------------------
+// Make every move from a few random boards both ways, and count the squares or
+// scores that differ
+static int64_t countReferenceMismatches(int n, uint64_t seed, WorkStealingPool &pool)
+{
+	int64_t mismatches = 0;
+	GameRng rng(seed, 1);
+	for (int trial = 0; trial < 2; trial++)
+	{
+		BigBoard board(n, seed, trial);
+		fillRandomly(board, rng);
+		std::vector<uint64_t> plain((size_t)n * n);
+		for (int r = 0; r < n; r++)
+		{
+			for (int c = 0; c < n; c++)
+			{
+				plain[(size_t)r * n + c] = board.get(r, c);
+			}
+		}
+		uint64_t plainScore = 0;
+		for (int d = 0; d < NumberOfDirections; d++)
+		{
+			board.slide((Direction)d, &pool);
+			referenceSlide(plain, n, (Direction)d, plainScore);
+			for (int r = 0; r < n; r++)
+			{
+				for (int c = 0; c < n; c++)
+				{
+					mismatches += (board.get(r, c) != plain[(size_t)r * n + c]);
+				}
+			}
+			mismatches += (board.getScore() != plainScore);
+		}
+	}
+	return mismatches;
+}
+
+//-------------------------------------------------------------------------------------
+static void displayBigBoardUsage()
+{
+	std::cout << "Usage: 1024 --bigboard [--size S] [--moves M] [--threads T] [--seed X]\n";
+}
+
+//-------------------------------------------------------------------------------------
+// Handle "--bigboard" on the command line: time random moves on one big board, then
+// check the slides against the plain ones.  Returns the program's exit status.
+int runBigBoardCommand(int argc, char *argv[])
+{
+	int squaresPerSide = 1024;
+	int moves = 100;
+	int numberOfThreads = 0;
+	uint64_t seed = 1;
+	for (int i = 2; i < argc; i++)
+	{
+		const char *option = argv[i];
+		const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+		if (value == NULL)
+		{
+			displayBigBoardUsage();
+			return 1;
+		}
+		if (strcmp(option, "--size") == 0) {
+			squaresPerSide = atoi(value);
+		}
+		else if (strcmp(option, "--moves") == 0) {
+			moves = atoi(value);
+		}
+		else if (strcmp(option, "--threads") == 0) {
+			numberOfThreads = atoi(value);
+		}
+		else if (strcmp(option, "--seed") == 0) {
+			seed = strtoull(value, NULL, 10);
+		}
+		else {
+			displayBigBoardUsage();
+			return 1;
+		}
+		i++;   // Skip over the value
+	}
+	if (squaresPerSide < MinBoardSize || moves < 1)
+	{
+		displayBigBoardUsage();
+		return 1;
+	}
+
+	WorkStealingPool pool(numberOfThreads);
+	BigBoard board(squaresPerSide, seed, 0);
+	GameRng rng(seed, 0);
+	fillRandomly(board, rng);
+
+	// Random directions, falling back to the others when one does not change the board
+	int64_t made = 0;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (int m = 0; m < moves; m++)
+	{
+		int first = rng.nextBelow(NumberOfDirections);
+		for (int k = 0; k < NumberOfDirections; k++)
+		{
+			if (board.makeMove((Direction)((first + k) % NumberOfDirections), &pool))
+			{
+				made++;
+				break;
+			}
+		}
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+	int64_t mismatches = countReferenceMismatches(std::min(squaresPerSide, 1024), seed, pool);
+
+	double squares = (double)squaresPerSide * squaresPerSide;
+	std::cout << std::fixed << std::setprecision(1)
+		<< "board: " << squaresPerSide << "x" << squaresPerSide << "\n"
+		<< "threads: " << pool.getNumberOfThreads() << "\n"
+		<< "moves: " << made << "\n"
+		<< "seconds: " << std::setprecision(3) << elapsed.count() << "\n"
+		<< std::setprecision(1)
+		<< "moves_per_sec: " << made / elapsed.count() << "\n"
+		<< "squares_per_sec: " << std::setprecision(0) << made * squares / elapsed.count() << "\n"
+		<< "score: " << board.getScore() << "\n"
+		<< "empty_squares: " << board.countEmpty() << "\n"
+		<< "reference_mismatches: " << mismatches << "\n";
+	return mismatches == 0 ? 0 : 1;
+}
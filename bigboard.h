@@ -0,0 +1,85 @@
+//  bigboard.h
+//     Boards of any size, for stress tests far beyond the MaxBoardSize x MaxBoardSize
+//     boards the game is played on, up to 4096 x 4096 and more.  Tiles and the score
+//     are 64-bit, since tiles on boards this large grow well past 2^31.
+//
+//     The squares are kept in one block allocated at run time, aligned to a cache
+//     line, with every row padded out to a whole number of cache lines so each row
+//     starts on one.  Every row, or column, slides independently of the others, so
+//     above ParallelSide squares per side a move is split into tasks over groups of
+//     lines and run on a WorkStealingPool.
+//
+//     Sliding column by column would stride a whole row's length through memory for
+//     every square.  Vertical moves instead slide a strip of ColumnBlock neighboring
+//     columns together, one row at a time, so every step reads one cache line holding
+//     a square of each of the strip's columns.
+//
+//     Started from the command line with:
+//        1024 --bigboard [--size S] [--moves M] [--threads T] [--seed X]
+//     which times random moves on an S x S board, then checks the slides against a
+//     plain one-line-at-a-time slide.
+
+#ifndef BIGBOARD_H
+#define BIGBOARD_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "board.h"
+#include "gamerng.h"
+
+class WorkStealingPool;
+
+class BigBoard
+{
+public:
+	static const int CacheLineSquares = 8;      // 64-bit squares in a 64-byte cache line
+	static const int ColumnBlock = CacheLineSquares;   // Columns slid together by vertical moves
+	static const int ParallelSide = 256;        // Smallest board slid with more than one thread
+
+	BigBoard(int squaresPerSide, uint64_t seed, uint64_t gameIndex);
+
+	// cells points into the board's own storage, so a copy would share the original's squares
+	BigBoard(const BigBoard &) = delete;
+	BigBoard &operator=(const BigBoard &) = delete;
+
+	void clear();
+	bool slide(Direction direction, WorkStealingPool *pool = NULL);
+	bool makeMove(Direction direction, WorkStealingPool *pool = NULL);
+	bool placeRandomPiece();
+
+	int getSquaresPerSide() const { return squaresPerSide; }
+	uint64_t get(int row, int col) const { return cells[(size_t)row * stride + col]; }
+	void set(int row, int col, uint64_t value);
+	uint64_t getScore() const { return score; }
+	int64_t countEmpty() const;
+
+private:
+	// What the slide of one group of lines did
+	struct SlideTotals
+	{
+		uint64_t gain;
+		bool changed;
+	};
+
+	uint64_t *row(int r) { return cells + (size_t)r * stride; }
+	SlideTotals slideRows(int firstRow, int endRow, bool backwards);
+	SlideTotals slideStrips(int firstStrip, int endStrip, bool backwards);
+	void countEmptyByRows();
+
+	int squaresPerSide;
+	int stride;                       // Squares from the start of one row to the next
+	std::vector<uint64_t> storage;    // Holds the squares, with room to align them
+	uint64_t *cells;                  // Square (r, c) at cells[r * stride + c], cache-line aligned
+	uint64_t score;
+	GameRng rng;
+
+	// Empty squares in each row, or in each strip of ColumnBlock columns after a
+	// vertical move, so a random empty square is found without a pass over the board
+	bool emptyByStrips;
+	std::vector<int64_t> emptyPerLine;
+};
+
+int runBigBoardCommand(int argc, char *argv[]);
+
+#endif // BIGBOARD_H
@@ -0,0 +1,129 @@
+//  bitboard.cpp
+//     Table construction and conversion to and from the regular int board for the
+//     packed 4x4 board.  See bitboard.h for the layout.
+
+#include "bitboard.h"
+#include <mutex>             // For std::call_once, so the tables are only built once
+
+uint16_t RowLeftTable[65536];
+uint16_t RowRightTable[65536];
+uint32_t RowLeftScoreTable[65536];
+uint32_t RowRightScoreTable[65536];
+
+
+//-------------------------------------------------------------------------------------
+// Reverse the order of the four nibbles in a 16-bit row
+static unsigned reverseRow(unsigned row)
+{
+	return ((row & 0x000F) << 12) | ((row & 0x00F0) << 4)
+		| ((row & 0x0F00) >> 4) | ((row & 0xF000) >> 12);
+}
+
+//-------------------------------------------------------------------------------------
+// Slide a single row of four exponents to the left, the same way slideLeft() does
+// for a row of the int board: pack the tiles to the left, merge equal neighbors
+// from the left, then pack again.  Returns the new row and sets score to the
+// points gained.  Tiles with the largest exponent are not merged, since their sum
+// would not fit in a nibble.
+static unsigned slideRowLeft(unsigned row, unsigned &score)
+{
+	int line[BitboardSide];
+	int count = 0;
+	for (int i = 0; i < BitboardSide; i++)
+	{
+		int exponent = (row >> (4 * i)) & 0xF;
+		if (exponent != 0)
+		{
+			line[count++] = exponent;
+		}
+	}
+
+	int result[BitboardSide] = { 0, 0, 0, 0 };
+	int resultCount = 0;
+	score = 0;
+	for (int i = 0; i < count; i++)
+	{
+		if (i + 1 < count && line[i] == line[i + 1] && line[i] < MaxBitboardExponent)
+		{
+			result[resultCount++] = line[i] + 1;
+			score += 1u << (line[i] + 1);
+			i++;   // The neighbor has been merged in, so skip it
+		}
+		else
+		{
+			result[resultCount++] = line[i];
+		}
+	}
+
+	unsigned newRow = 0;
+	for (int i = 0; i < BitboardSide; i++)
+	{
+		newRow |= result[i] << (4 * i);
+	}
+	return newRow;
+}
+
+//-------------------------------------------------------------------------------------
+static void buildTables()
+{
+	for (unsigned row = 0; row < 65536; row++)
+	{
+		unsigned score;
+		RowLeftTable[row] = (uint16_t)slideRowLeft(row, score);
+		RowLeftScoreTable[row] = score;
+
+		// Sliding right is sliding the reversed row left, then reversing the result
+		RowRightTable[row] = (uint16_t)reverseRow(slideRowLeft(reverseRow(row), score));
+		RowRightScoreTable[row] = score;
+	}
+}
+
+//-------------------------------------------------------------------------------------
+// Build the row lookup tables.  Safe to call more than once, and from several threads.
+void initializeBitboardTables()
+{
+	static std::once_flag tablesBuilt;
+	std::call_once(tablesBuilt, buildTables);
+}
+
+//-------------------------------------------------------------------------------------
+// Convert a 4x4 int board into its packed form.  Returns false, leaving packed
+// unchanged, if some square does not hold 0 or a power of two up to 16384 (for
+// instance after a value was placed with the 'p' command).  A 32768 fits in a nibble
+// but two of them could not merge there, so boards holding one are left to the
+// unpacked kernels too.
+bool packBoard(const int board[], Bitboard &packed)
+{
+	Bitboard result = 0;
+	for (int i = 0; i < BitboardSide * BitboardSide; i++)
+	{
+		int value = board[i];
+		int exponent = 0;
+		if (value != 0)
+		{
+			if (value < 2 || (value & (value - 1)) != 0)
+			{
+				return false;   // Not a power of two
+			}
+			exponent = lowestSetBit((uint64_t)value);
+			if (exponent >= MaxBitboardExponent)
+			{
+				return false;
+			}
+		}
+		result |= (Bitboard)exponent << (4 * i);
+	}
+	packed = result;
+	return true;
+}
+
+//-------------------------------------------------------------------------------------
+// Convert a packed board back into the first 16 squares of an int board
+void unpackBoard(Bitboard packed, int board[])
+{
+	for (int i = 0; i < BitboardSide * BitboardSide; i++)
+	{
+		int exponent = (int)((packed >> (4 * i)) & 0xF);
+		board[i] = (exponent == 0) ? 0 : (1 << exponent);
+	}
+}
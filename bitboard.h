@@ -0,0 +1,236 @@
+//  bitboard.h
+//     Packed 4x4 board for 1024, used where large numbers of moves have to be made
+//     quickly (simulations, searches).  The whole board is a single 64-bit integer
+//     holding one 4-bit tile exponent per square: 0 is an empty square, 1 is a 2,
+//     2 is a 4, ... and 15 is a 32768.
+//
+//     Square i of the regular row-major int board is stored in bits 4*i .. 4*i+3,
+//     so every row of the board is one 16-bit chunk with its leftmost square in the
+//     low nibble.  A slide left or right is then four lookups of a 16-bit row into
+//     precomputed 65536-entry tables.  Up and down moves transpose the board so the
+//     columns become rows, slide those, and transpose back.
+//
+//     initializeBitboardTables() must be called once before any of the slide functions.
+
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <cstdint>
+#include "board.h"           // For Direction
+#ifdef _MSC_VER
+#include <intrin.h>          // For _BitScanForward64
+#endif
+
+typedef uint64_t Bitboard;
+
+const int BitboardSide = 4;           // Packed boards are always 4x4
+const int MaxBitboardExponent = 15;   // Largest exponent that fits in a nibble (32768)
+
+// Row lookup tables, indexed by a 16-bit row.  Filled in by initializeBitboardTables().
+extern uint16_t RowLeftTable[65536];         // Row after sliding it left
+extern uint16_t RowRightTable[65536];        // Row after sliding it right
+extern uint32_t RowLeftScoreTable[65536];    // Points scored sliding the row left
+extern uint32_t RowRightScoreTable[65536];   // Points scored sliding the row right
+
+void initializeBitboardTables();
+bool packBoard(const int board[], Bitboard &packed);
+void unpackBoard(Bitboard packed, int board[]);
+
+
+//-------------------------------------------------------------------------------------
+// Swap rows and columns, so square (row, col) moves to (col, row).
+inline Bitboard transposeBitboard(Bitboard packed)
+{
+	// First swap the 2x2 blocks of nibbles, then the nibbles within each block
+	Bitboard a1 = packed & 0xF0F00F0FF0F00F0FULL;
+	Bitboard a2 = packed & 0x0000F0F00000F0F0ULL;
+	Bitboard a3 = packed & 0x0F0F00000F0F0000ULL;
+	Bitboard a = a1 | (a2 << 12) | (a3 >> 12);
+	Bitboard b1 = a & 0xFF00FF0000FF00FFULL;
+	Bitboard b2 = a & 0x00FF00FF00000000ULL;
+	Bitboard b3 = a & 0x00000000FF00FF00ULL;
+	return b1 | (b2 >> 24) | (b3 << 24);
+}
+
+//-------------------------------------------------------------------------------------
+// Reverse every row, so square (row, col) moves to (row, 3 - col)
+inline Bitboard mirrorBitboardColumns(Bitboard packed)
+{
+	packed = ((packed >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((packed & 0x0F0F0F0F0F0F0F0FULL) << 4);
+	return ((packed >> 8) & 0x00FF00FF00FF00FFULL) | ((packed & 0x00FF00FF00FF00FFULL) << 8);
+}
+
+//-------------------------------------------------------------------------------------
+// Reverse the order of the rows, so square (row, col) moves to (3 - row, col)
+inline Bitboard mirrorBitboardRows(Bitboard packed)
+{
+	packed = ((packed >> 16) & 0x0000FFFF0000FFFFULL) | ((packed & 0x0000FFFF0000FFFFULL) << 16);
+	return (packed >> 32) | (packed << 32);
+}
+
+//-------------------------------------------------------------------------------------
+// The board seen through each of the 8 symmetries of the square, numbered as in
+// zobrist.h: turned[s] is transposed if bit 2 of s is set, then its columns are
+// mirrored if bit 0 is set and its rows if bit 1 is set
+inline void bitboardSymmetries(Bitboard packed, Bitboard turned[])
+{
+	Bitboard transposed = transposeBitboard(packed);
+	turned[0] = packed;
+	turned[1] = mirrorBitboardColumns(packed);
+	turned[2] = mirrorBitboardRows(packed);
+	turned[3] = mirrorBitboardRows(turned[1]);
+	turned[4] = transposed;
+	turned[5] = mirrorBitboardColumns(transposed);
+	turned[6] = mirrorBitboardRows(transposed);
+	turned[7] = mirrorBitboardRows(turned[5]);
+}
+
+//-------------------------------------------------------------------------------------
+// Mask with the low bit of every empty square's nibble set (bit 4*i for square i)
+inline uint64_t emptySquaresMask(Bitboard packed)
+{
+	uint64_t occupied = packed | (packed >> 1);
+	occupied |= occupied >> 2;
+	return ~occupied & 0x1111111111111111ULL;
+}
+
+//-------------------------------------------------------------------------------------
+// Exponent of the largest tile on the board
+inline int maxBitboardExponent(Bitboard packed)
+{
+	int largest = 0;
+	for (int i = 0; i < BitboardSide * BitboardSide; i++)
+	{
+		int exponent = (int)((packed >> (4 * i)) & 0xF);
+		if (exponent > largest)
+		{
+			largest = exponent;
+		}
+	}
+	return largest;
+}
+
+//-------------------------------------------------------------------------------------
+// Whether a move in any direction would change the board.  A move is possible if
+// some pair of neighbors along a row or column holds two equal tiles, or a tile and
+// an empty square.  Every pair is checked at once: packed >> 4 lines each square up
+// with its right neighbor and packed >> 16 with the one below, and the masks keep
+// only the pairs that do not run off the edge.
+inline bool bitboardHasMove(Bitboard packed)
+{
+	uint64_t empty = emptySquaresMask(packed);
+	uint64_t equalRight = emptySquaresMask(packed ^ (packed >> 4));
+	uint64_t equalBelow = emptySquaresMask(packed ^ (packed >> 16));
+	uint64_t horizontal = ((equalRight & ~empty) | (empty ^ (empty >> 4))) & 0x0111011101110111ULL;
+	uint64_t vertical = ((equalBelow & ~empty) | (empty ^ (empty >> 16))) & 0x0000111111111111ULL;
+	return (horizontal | vertical) != 0;
+}
+
+//-------------------------------------------------------------------------------------
+// Index of the lowest set bit of a non-zero mask
+inline int lowestSetBit(uint64_t mask)
+{
+#ifdef _MSC_VER
+	unsigned long bit;
+	_BitScanForward64(&bit, mask);
+	return (int)bit;
+#else
+	return __builtin_ctzll(mask);
+#endif
+}
+
+//-------------------------------------------------------------------------------------
+// Index of the highest set bit of a non-zero mask
+inline int highestSetBit(uint64_t mask)
+{
+#ifdef _MSC_VER
+	unsigned long bit;
+	_BitScanReverse64(&bit, mask);
+	return (int)bit;
+#else
+	return 63 - __builtin_clzll(mask);
+#endif
+}
+
+//-------------------------------------------------------------------------------------
+// Index of the square whose nibble holds the lowest set bit of a non-zero mask
+inline int lowestSetNibble(uint64_t mask)
+{
+	return lowestSetBit(mask) / 4;
+}
+
+//-------------------------------------------------------------------------------------
+// Slide every row of the packed board through the given row table, adding the
+// points from the matching score table to score.
+inline Bitboard slideBitboardRows(Bitboard packed, const uint16_t rowTable[],
+	const uint32_t scoreTable[], int &score)
+{
+	unsigned row0 = (unsigned)(packed & 0xFFFF);
+	unsigned row1 = (unsigned)((packed >> 16) & 0xFFFF);
+	unsigned row2 = (unsigned)((packed >> 32) & 0xFFFF);
+	unsigned row3 = (unsigned)((packed >> 48) & 0xFFFF);
+	score += scoreTable[row0] + scoreTable[row1] + scoreTable[row2] + scoreTable[row3];
+	return (Bitboard)rowTable[row0]
+		| ((Bitboard)rowTable[row1] << 16)
+		| ((Bitboard)rowTable[row2] << 32)
+		| ((Bitboard)rowTable[row3] << 48);
+}
+
+//-------------------------------------------------------------------------------------
+// Packed equivalents of slideLeft(), slideRight(), slideUp() and slideDown()
+inline Bitboard bitboardSlideLeft(Bitboard packed, int &score)
+{
+	return slideBitboardRows(packed, RowLeftTable, RowLeftScoreTable, score);
+}
+
+inline Bitboard bitboardSlideRight(Bitboard packed, int &score)
+{
+	return slideBitboardRows(packed, RowRightTable, RowRightScoreTable, score);
+}
+
+// In the transposed board each row is a column with its top square in the low
+// nibble, so moving up is a slide left and moving down is a slide right.
+inline Bitboard bitboardSlideUp(Bitboard packed, int &score)
+{
+	return transposeBitboard(
+		slideBitboardRows(transposeBitboard(packed), RowLeftTable, RowLeftScoreTable, score));
+}
+
+inline Bitboard bitboardSlideDown(Bitboard packed, int &score)
+{
+	return transposeBitboard(
+		slideBitboardRows(transposeBitboard(packed), RowRightTable, RowRightScoreTable, score));
+}
+
+//-------------------------------------------------------------------------------------
+// All four moves at once, for searches that need every successor of a position.
+// Every row is looked up once for both left and right, and the board is transposed
+// once so every column is looked up once for both up and down.  A line scores the
+// same whichever way it slides (each run of k equal tiles merges into k/2 pairs
+// either way), so one score lookup serves both directions.  results and gains are
+// indexed by Direction.
+inline void bitboardSlideAll(Bitboard packed, Bitboard results[], int gains[])
+{
+	Bitboard columns = transposeBitboard(packed);
+	Bitboard left = 0, right = 0, up = 0, down = 0;
+	int rowGain = 0, columnGain = 0;
+	for (int i = 0; i < BitboardSide; i++)
+	{
+		unsigned row = (unsigned)((packed >> (16 * i)) & 0xFFFF);
+		unsigned column = (unsigned)((columns >> (16 * i)) & 0xFFFF);
+		left |= (Bitboard)RowLeftTable[row] << (16 * i);
+		right |= (Bitboard)RowRightTable[row] << (16 * i);
+		up |= (Bitboard)RowLeftTable[column] << (16 * i);
+		down |= (Bitboard)RowRightTable[column] << (16 * i);
+		rowGain += RowLeftScoreTable[row];
+		columnGain += RowLeftScoreTable[column];
+	}
+	results[DirectionLeft] = left;
+	results[DirectionRight] = right;
+	results[DirectionUp] = transposeBitboard(up);
+	results[DirectionDown] = transposeBitboard(down);
+	gains[DirectionLeft] = gains[DirectionRight] = rowGain;
+	gains[DirectionUp] = gains[DirectionDown] = columnGain;
+}
+
+#endif // BITBOARD_H
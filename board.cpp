@@ -0,0 +1,292 @@
+//  board.cpp
+//     Functions that work directly on the int board: initializing and copying it,
+//     placing random pieces, and the original slide functions.  The game itself makes
+//     its moves with the faster kernels in boardkernels.h; the slide functions here
+//     are kept as the reference those kernels must agree with.
+
+#include "board.h"
+#include "emptycells.h"
+#include "gamerng.h"
+
+//--------------------------------------------------------------------
+// Place a randomly selected 2 or 4 into a random open square on
+// the board.  The open squares are kept in emptyCells, so the square
+// is a single random pick.  All randomness comes from the game's
+// own rng.  Returns the square the piece went in, or -1, leaving
+// the board as it is, if there are no open squares.
+int placeRandomPiece(int board[], EmptyCells &emptyCells, GameRng &rng)
+{
+	if (emptyCells.count() == 0)
+	{
+		return -1;
+	}
+
+	// Randomly choose a piece to be placed (2 or 4)
+	int pieceToPlace = 2;
+	if (rng.nextBelow(2) == 1) {
+		pieceToPlace = 4;
+	}
+
+	// Pick one of the unoccupied squares and place the piece there
+	int index = emptyCells.cell(rng.nextBelow(emptyCells.count()));
+	board[index] = pieceToPlace;
+	emptyCells.setFilled(index);
+	return index;
+}//end placeRandomPiece()
+
+//-------------------------------------------------------------------------------------
+// Initializes the board to 0
+void initializeBoard(int board[], int squaresPerSide, int value)
+{
+	int i;
+	for (i = 0; i < squaresPerSide * squaresPerSide; i++)
+	{
+		board[i] = value;
+	}
+}
+
+//------------------------------------------------------------------------------------
+// Creates a copy of the board
+void copyBoard(const int sourceBoard[], int board2[], int squaresPerSide)
+{
+	int i;
+	for (i = 0; i < squaresPerSide * squaresPerSide; i++)
+	{
+		board2[i] = sourceBoard[i];
+	}
+}
+
+//-------------------------------------------------------------------------------------
+// moveNumbers all pieces to the left
+// User input is: 'a'
+void slideLeft(int board[], int squaresPerSide, int &score)
+{
+	// Slide the values to the left
+	for (int current = 0; current < squaresPerSide * squaresPerSide; current++)
+	{
+		if (board[current] != 0)
+		{
+			while (current >= 0
+				&& current % squaresPerSide != 0
+				&& board[current - 1] == 0
+				&& current <= squaresPerSide * squaresPerSide)
+			{
+				board[current - 1] = board[current];
+				board[current] = 0;
+				current -= (current + 1);
+			}
+		}
+	}
+	// If the adjacent values to the left are the same then merge
+	for (int current = 0; current < squaresPerSide * squaresPerSide; current++)
+	{
+		if (current % squaresPerSide != 0 && board[current] == board[current - 1])
+		{
+			board[current - 1] += board[current];
+			board[current] = 0;
+			score += board[current - 1];
+		}
+	}
+	// Shift values to the left again to avoid merging all values to the left if applicable
+	for (int current = 0; current < squaresPerSide * squaresPerSide; current++)
+	{
+		if (board[current] != 0)
+		{
+			while (current >= 0
+				&& current % squaresPerSide != 0
+				&& board[current - 1] == 0
+				&& current <= squaresPerSide * squaresPerSide)
+			{
+				board[current - 1] = board[current];
+				board[current] = 0;
+				current -= (current + 1);
+			}
+		}
+	}
+}
+
+//-------------------------------------------------------------------------------------
+// moveNumbers all pieces to the right
+// User input is: 'd'
+void slideRight(int board[], int squaresPerSide, int &score)
+{
+	// Slide the values to the right.  Working from the right edge, every tile to the
+	// right of current has already been slid, so each tile only needs one pass.
+	for (int current = squaresPerSide * squaresPerSide - 1; current >= 0; current--)
+	{
+		if (board[current] != 0)
+		{
+			while ((current + 1) % squaresPerSide != 0
+				&& board[current + 1] == 0)
+			{
+				board[current + 1] = board[current];
+				board[current] = 0;
+				current++;
+			}
+		}
+	}
+	// If the adjacent values to the right are the same then merge.  Working from the
+	// right means a merged tile is never merged a second time in the same move.
+	for (int current = squaresPerSide * squaresPerSide - 1; current >= 0; current--)
+	{
+		if ((current + 1) % squaresPerSide != 0 && board[current] == board[current + 1])
+		{
+			board[current + 1] += board[current];
+			board[current] = 0;
+			score += board[current + 1];
+		}
+	}
+	// Shift values to the right again to close the gaps left by merging
+	for (int current = squaresPerSide * squaresPerSide - 1; current >= 0; current--)
+	{
+		if (board[current] != 0)
+		{
+			while ((current + 1) % squaresPerSide != 0
+				&& board[current + 1] == 0)
+			{
+				board[current + 1] = board[current];
+				board[current] = 0;
+				current++;
+			}
+		}
+	}
+}
+
+//----------------------------------------------------------------------------------------------------
+// moveNumbers all pieces upward
+// User input is: 'w'
+void slideUp(int board[], int squaresPerSide, int &score)
+{
+	// Shift all values upward
+	for (int current = 0; current < squaresPerSide * squaresPerSide; current++)
+	{
+		if (board[current] != 0)
+		{
+			while (current >= squaresPerSide
+				&& board[current - squaresPerSide] == 0
+				&& current <= squaresPerSide * squaresPerSide)
+			{
+				board[current - squaresPerSide] = board[current];
+				board[current] = 0;
+				current = current - (squaresPerSide + 1);
+			}
+		}
+	}
+	// If values upward are the same value then merge the values
+	for (int current = 0; current < (squaresPerSide * squaresPerSide); current++)
+	{
+		if (current >= squaresPerSide && board[current] == board[current - squaresPerSide])
+		{
+			board[current - squaresPerSide] += board[current];
+			board[current] = 0;
+			score += board[current - squaresPerSide];
+		}
+	}
+	// Shift values upward again to avoid merging all values at once
+	for (int current = 0; current < squaresPerSide * squaresPerSide; current++)
+	{
+		if (board[current] != 0)
+		{
+			while (current >= squaresPerSide
+				&& board[current - squaresPerSide] == 0
+				&& current <= squaresPerSide * squaresPerSide)
+			{
+				board[current - squaresPerSide] = board[current];
+				board[current] = 0;
+				current = current - (squaresPerSide + 1);
+			}
+		}
+	}
+}
+
+//-------------------------------------------------------------------------------------
+// moveNumbers all pieces downward
+// User input is: 's'
+void slideDown(int board[], int squaresPerSide, int &score)
+{
+	// Slide the values of the board downward
+	for (int current = (squaresPerSide * squaresPerSide - 1); current >= 0; current--)
+	{
+		if (board[current] != 0)
+		{
+			while (current < (squaresPerSide * squaresPerSide - squaresPerSide)
+				&& board[current + squaresPerSide] == 0
+				&& current <= squaresPerSide * squaresPerSide)
+			{
+				board[current + squaresPerSide] = board[current];
+				board[current] = 0;
+				current = current + (squaresPerSide + 1);
+			}
+		}
+	}
+	// If any adjacent values when going down are the same, then merge
+	for (int current = (squaresPerSide * squaresPerSide - 1); current >= 0; current--)
+	{
+		if (current < (squaresPerSide * squaresPerSide - squaresPerSide)
+			&& board[current] == board[current + squaresPerSide])
+		{
+			board[current + squaresPerSide] += board[current];
+			board[current] = 0;
+			score += board[current + squaresPerSide];
+		}
+	}
+	// Shift downward again to avoid merging all values at once
+	for (int current = (squaresPerSide * squaresPerSide - 1); current >= 0; current--)
+	{
+		if (board[current] != 0) {
+			while (current < (squaresPerSide * squaresPerSide - squaresPerSide)
+				&& board[current + squaresPerSide] == 0
+				&& current <= squaresPerSide * squaresPerSide)
+			{
+				board[current + squaresPerSide] = board[current];
+				board[current] = 0;
+				current = current + (squaresPerSide + 1);
+			}
+		}
+	}
+}
+
+//--------------------------------------------------------------------------------------
+// Sets the piece value where user wants
+void setPiece(int board[], int index, int value)
+{
+	board[index] = value;
+}
+
+//----------------------------------------------------------------------------------------
+// Return the exponent value
+int raiseToThePowerOf(int square, int powerOf)
+{
+	int exponent = 1;
+	for (int i = 1; i <= powerOf; i++)
+	{
+		exponent = exponent * square;
+	}
+	return exponent;
+}
+
+//-----------------------------------------------------------------------------------------
+// Tests to see if the game is over: every square is filled and no piece matches
+// the piece to its right or below it, so no move can change the board.
+// If it is over then the function will return true
+bool gameNotFinished(int board[], int squaresPerSide)
+{
+	for (int i = 0; i < squaresPerSide * squaresPerSide; i++)
+	{
+		// An empty square leaves room for some piece to slide
+		if (board[i] == 0)
+		{
+			return false;
+		}
+		// Matching neighbors can be merged
+		if ((i % squaresPerSide) + 1 < squaresPerSide && board[i] == board[i + 1])
+		{
+			return false;
+		}
+		if (i + squaresPerSide < squaresPerSide * squaresPerSide && board[i] == board[i + squaresPerSide])
+		{
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,31 @@
+//  board.h
+//     Constants shared by the game and the board kernels that make its moves, and the
+//     functions in board.cpp that work directly on the int board.
+
+#ifndef BOARD_H
+#define BOARD_H
+
+const int MinBoardSize = 4;    // Min number of squares per side
+const int MaxBoardSize = 12;   // Max number of squares per side
+
+// The four ways pieces can be slid.  Kernels use these as indexes into their tables.
+enum Direction { DirectionLeft, DirectionRight, DirectionUp, DirectionDown };
+const int NumberOfDirections = 4;
+
+class EmptyCells;
+class GameRng;
+
+void initializeBoard(int board[], int squaresPerSide, int value);
+void copyBoard(const int sourceBoard[], int board2[], int squaresPerSide);
+int placeRandomPiece(int board[], EmptyCells &emptyCells, GameRng &rng);
+void setPiece(int board[], int index, int value);
+int raiseToThePowerOf(int square, int powerOf);
+bool gameNotFinished(int board[], int squaresPerSide);
+
+// Reference slide functions
+void slideLeft(int board[], int squaresPerSide, int &score);
+void slideRight(int board[], int squaresPerSide, int &score);
+void slideUp(int board[], int squaresPerSide, int &score);
+void slideDown(int board[], int squaresPerSide, int &score);
+
+#endif // BOARD_H
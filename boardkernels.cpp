@@ -0,0 +1,206 @@
+//  boardkernels.cpp
+//     Instantiations of the size-specialized move kernels for every supported board
+//     size, and the single dispatch that picks one of them.
+
+#include "boardkernels.h"
+#include "bitboard.h"
+
+typedef bool (*SlideKernel)(int board[], int &score, EmptyCells *emptyCells, int *maxTile);
+typedef bool (*TracedSlideKernel)(int board[], int &score, EmptyCells *emptyCells, int *maxTile,
+	MoveTrace &trace);
+typedef bool (*CanMoveKernel)(const int board[]);
+typedef void (*SlideAllKernel)(const int board[], int *results[], int gains[], bool changed[]);
+
+// Declare the four direction kernels for one board size
+#define BOARD_KERNELS(N) \
+	{ slideBoardKernel<N, DirectionLeft>, slideBoardKernel<N, DirectionRight>, \
+	  slideBoardKernel<N, DirectionUp>, slideBoardKernel<N, DirectionDown> }
+
+// One row per board size from MinBoardSize to MaxBoardSize
+static const SlideKernel SlideKernels[MaxBoardSize - MinBoardSize + 1][NumberOfDirections] = {
+	BOARD_KERNELS(4), BOARD_KERNELS(5), BOARD_KERNELS(6),
+	BOARD_KERNELS(7), BOARD_KERNELS(8), BOARD_KERNELS(9),
+	BOARD_KERNELS(10), BOARD_KERNELS(11), BOARD_KERNELS(12)
+};
+
+#undef BOARD_KERNELS
+
+// The same, leaving a trace of the move
+#define TRACED_KERNELS(N) \
+	{ slideBoardTraced<N, DirectionLeft, MoveTrace>, slideBoardTraced<N, DirectionRight, MoveTrace>, \
+	  slideBoardTraced<N, DirectionUp, MoveTrace>, slideBoardTraced<N, DirectionDown, MoveTrace> }
+
+static const TracedSlideKernel TracedSlideKernels[MaxBoardSize - MinBoardSize + 1][NumberOfDirections] = {
+	TRACED_KERNELS(4), TRACED_KERNELS(5), TRACED_KERNELS(6),
+	TRACED_KERNELS(7), TRACED_KERNELS(8), TRACED_KERNELS(9),
+	TRACED_KERNELS(10), TRACED_KERNELS(11), TRACED_KERNELS(12)
+};
+
+#undef TRACED_KERNELS
+
+static const CanMoveKernel CanMoveKernels[MaxBoardSize - MinBoardSize + 1] = {
+	canMoveKernel<4>, canMoveKernel<5>, canMoveKernel<6>,
+	canMoveKernel<7>, canMoveKernel<8>, canMoveKernel<9>,
+	canMoveKernel<10>, canMoveKernel<11>, canMoveKernel<12>
+};
+
+static const SlideAllKernel SlideAllKernels[MaxBoardSize - MinBoardSize + 1] = {
+	slideAllKernel<4>, slideAllKernel<5>, slideAllKernel<6>,
+	slideAllKernel<7>, slideAllKernel<8>, slideAllKernel<9>,
+	slideAllKernel<10>, slideAllKernel<11>, slideAllKernel<12>
+};
+
+
+//-------------------------------------------------------------------------------------
+// Make a move on a 4x4 board using the packed bitboard kernels.  Returns false
+// without changing anything if the board holds a value that cannot be packed (for
+// instance one placed with the 'p' command), otherwise sets changed to whether
+// the move changed the board.  Squares that became empty or filled are recorded in
+// emptyCells, and the largest merged tile in maxTile, if they are not NULL.
+static bool slidePackedBoard(int board[], Direction direction, int &score, bool &changed,
+	EmptyCells *emptyCells, int *maxTile)
+{
+	Bitboard packed;
+	if (!packBoard(board, packed))
+	{
+		return false;
+	}
+
+	int oldScore = score;
+	Bitboard result = packed;
+	switch (direction) {
+	case DirectionLeft:  result = bitboardSlideLeft(packed, score);  break;
+	case DirectionRight: result = bitboardSlideRight(packed, score); break;
+	case DirectionUp:    result = bitboardSlideUp(packed, score);    break;
+	case DirectionDown:  result = bitboardSlideDown(packed, score);  break;
+	}
+	changed = (result != packed);
+	if (changed)
+	{
+		unpackBoard(result, board);
+		if (emptyCells != NULL)
+		{
+			// Only the squares whose emptiness flipped need to be touched
+			uint64_t flipped = emptySquaresMask(packed) ^ emptySquaresMask(result);
+			while (flipped != 0)
+			{
+				int index = lowestSetNibble(flipped);
+				if (board[index] == 0)
+				{
+					emptyCells->setEmpty(index);
+				}
+				else
+				{
+					emptyCells->setFilled(index);
+				}
+				flipped &= flipped - 1;
+			}
+		}
+		if (maxTile != NULL && score - oldScore >= 2 * *maxTile)
+		{
+			// A merge makes at most twice the largest tile, and then scores at least that
+			// much, so only then can the largest tile have changed
+			int largest = 1 << maxBitboardExponent(result);
+			if (largest > *maxTile)
+			{
+				*maxTile = largest;
+			}
+		}
+	}
+	return true;
+}
+
+//-------------------------------------------------------------------------------------
+// Slide the pieces of a board with squaresPerSide squares per side in the given
+// direction, adding the value of every merged tile to score.  Returns true if the
+// move changed the board.  If emptyCells is not NULL it is kept in step with the
+// board, and if maxTile is not NULL it is raised to any larger merged tile.  4x4
+// boards use the packed bitboard tables when they can, every other size its own
+// compile-time specialized kernel.
+bool slideBoard(int board[], int squaresPerSide, Direction direction, int &score,
+	EmptyCells *emptyCells, int *maxTile)
+{
+	bool changed;
+	if (squaresPerSide == BitboardSide
+		&& slidePackedBoard(board, direction, score, changed, emptyCells, maxTile))
+	{
+		return changed;
+	}
+	return SlideKernels[squaresPerSide - MinBoardSize][direction](board, score, emptyCells, maxTile);
+}
+
+//-------------------------------------------------------------------------------------
+// Slide the board as above, and fill in trace with where every tile went.  Only the
+// window needs a trace, so 4x4 boards skip the packed tables here and use their
+// specialized kernel like every other size.  emptyCells must still come out in the
+// same order as from the untraced move, since the next piece is picked by its
+// position in that list: otherwise a game played in the window would place
+// different pieces from the same seed than the same game played any other way.
+bool slideBoard(int board[], int squaresPerSide, Direction direction, int &score,
+	MoveTrace &trace, EmptyCells *emptyCells, int *maxTile)
+{
+	trace.clear();
+	TracedSlideKernel kernel = TracedSlideKernels[squaresPerSide - MinBoardSize][direction];
+	Bitboard packed;
+	if (squaresPerSide == BitboardSide && emptyCells != NULL && packBoard(board, packed))
+	{
+		// Update the squares whose emptiness flipped in index order, as
+		// slidePackedBoard() does
+		bool changed = kernel(board, score, NULL, maxTile, trace);
+		if (changed)
+		{
+			for (int index = 0; index < BitboardSide * BitboardSide; index++)
+			{
+				bool empty = (board[index] == 0);
+				if (empty && !emptyCells->isEmpty(index))
+				{
+					emptyCells->setEmpty(index);
+				}
+				else if (!empty && emptyCells->isEmpty(index))
+				{
+					emptyCells->setFilled(index);
+				}
+			}
+		}
+		return changed;
+	}
+	return kernel(board, score, emptyCells, maxTile, trace);
+}
+
+//-------------------------------------------------------------------------------------
+// Whether a move in any direction would change the board, worked out without making
+// one.  4x4 boards that pack are checked with a few word operations.
+bool hasLegalMove(const int board[], int squaresPerSide)
+{
+	Bitboard packed;
+	if (squaresPerSide == BitboardSide && packBoard(board, packed))
+	{
+		return bitboardHasMove(packed);
+	}
+	return CanMoveKernels[squaresPerSide - MinBoardSize](board);
+}
+
+//-------------------------------------------------------------------------------------
+// Make all four moves from the board at once, leaving the board itself alone.  4x4
+// boards that pack are moved with the packed tables, every other board with its
+// size's single-pass kernel.
+void slideAllDirections(const int board[], int squaresPerSide, AllMoves &moves)
+{
+	Bitboard packed;
+	if (squaresPerSide == BitboardSide && packBoard(board, packed))
+	{
+		Bitboard results[NumberOfDirections];
+		bitboardSlideAll(packed, results, moves.gains);
+		for (int d = 0; d < NumberOfDirections; d++)
+		{
+			moves.changed[d] = (results[d] != packed);
+			unpackBoard(results[d], moves.boards[d]);
+		}
+		return;
+	}
+	int *results[NumberOfDirections] = {
+		moves.boards[DirectionLeft], moves.boards[DirectionRight],
+		moves.boards[DirectionUp], moves.boards[DirectionDown]
+	};
+	SlideAllKernels[squaresPerSide - MinBoardSize](board, results, moves.gains, moves.changed);
+}
@@ -0,0 +1,327 @@
+//  boardkernels.h
+//     Move kernels specialized at compile time for each supported board size.
+//
+//     For a board with N squares per side, BoardLines<N> lists, for each direction
+//     and each of the N rows or columns, the indexes of the squares along that line
+//     starting from the edge the pieces slide towards.  The table is built by a
+//     constexpr function, so inside slideLine<N, Direction>() every index is a
+//     compile-time constant and the loops over the line can be fully unrolled, with
+//     none of the "current % squaresPerSide" arithmetic of the generic slides.
+//
+//     The slides can also leave a trace of where every tile went, for the window to
+//     animate.  Whether they do is a compile-time policy: slideLine() reports each
+//     tile to its Trace parameter, and with NoTrace, whose record() is empty, the
+//     bookkeeping is optimized away entirely, so the untraced kernels are the same
+//     code they always were.
+//
+//     slideBoard() does the one dispatch on the board size and direction, and
+//     hasLegalMove() tells whether any direction would change the board without
+//     making a move.  slideAllDirections() makes all four moves from one position in
+//     a single pass, for the players and searches that need every successor.
+
+#ifndef BOARDKERNELS_H
+#define BOARDKERNELS_H
+
+#include "board.h"
+#include "emptycells.h"
+#include <cstddef>            // For NULL
+#include <cstdint>
+
+//-------------------------------------------------------------------------------------
+// Square indexes along every line of an N x N board, for every direction
+template<int N>
+struct BoardLines
+{
+	int cells[NumberOfDirections][N][N];
+};
+
+template<int N>
+constexpr BoardLines<N> makeBoardLines()
+{
+	BoardLines<N> lines = {};
+	for (int line = 0; line < N; line++)
+	{
+		for (int position = 0; position < N; position++)
+		{
+			// For left and right moves the lines are rows, for up and down they are columns
+			lines.cells[DirectionLeft][line][position] = line * N + position;
+			lines.cells[DirectionRight][line][position] = line * N + (N - 1 - position);
+			lines.cells[DirectionUp][line][position] = position * N + line;
+			lines.cells[DirectionDown][line][position] = (N - 1 - position) * N + line;
+		}
+	}
+	return lines;
+}
+
+template<int N>
+struct BoardKernelTables
+{
+	static constexpr BoardLines<N> lines = makeBoardLines<N>();
+};
+
+template<int N>
+constexpr BoardLines<N> BoardKernelTables<N>::lines;
+
+//-------------------------------------------------------------------------------------
+// Where one tile went in a move: the square it slid from, the square it ended up on,
+// and whether it merged there with another tile
+struct TileMove
+{
+	uint8_t from;
+	uint8_t to;
+	uint8_t merged;
+};
+
+// Trace policy that keeps nothing
+struct NoTrace
+{
+	void record(int, int, bool) { }
+};
+
+// Trace policy that keeps a TileMove for every tile on the board, including the ones
+// that stayed where they were, so the trace alone tells where everything went
+struct MoveTrace
+{
+	TileMove moves[MaxBoardSize * MaxBoardSize];
+	int count;
+
+	void clear() { count = 0; }
+	void record(int from, int to, bool merged)
+	{
+		TileMove move = { (uint8_t)from, (uint8_t)to, (uint8_t)merged };
+		moves[count++] = move;
+	}
+};
+
+//-------------------------------------------------------------------------------------
+// Slide one line of the board towards its first square, merging equal neighbors the
+// same way slideLeft() does: pack the tiles, merge pairs starting at the edge, then
+// pack again.  Adds the merged values to score and, if emptyCells is not NULL,
+// records every square that became empty or filled.  If maxTile is not NULL it is
+// raised to any larger merged tile.  Every tile's move is reported to trace.
+// Returns true if any square changed.
+template<int N, int Direction, class Trace>
+inline bool slideLine(int board[], int line, int &score, EmptyCells *emptyCells, int *maxTile,
+	Trace &trace)
+{
+	const int (&cells)[N] = BoardKernelTables<N>::lines.cells[Direction][line];
+
+	// Gather the tiles of the line, skipping empty squares, and the squares they came from
+	int tiles[N];
+	int from[N];
+	int count = 0;
+	for (int position = 0; position < N; position++)
+	{
+		int value = board[cells[position]];
+		tiles[count] = value;
+		from[count] = cells[position];
+		count += (value != 0);
+	}
+
+	// Write them back towards the edge, merging equal neighbors
+	bool changed = false;
+	int write = 0;
+	for (int read = 0; read < count; read++, write++)
+	{
+		int value = tiles[read];
+		if (read + 1 < count && tiles[read + 1] == value)
+		{
+			value += value;
+			score += value;
+			trace.record(from[read], cells[write], true);
+			read++;
+			trace.record(from[read], cells[write], true);
+			if (maxTile != NULL && value > *maxTile)
+			{
+				*maxTile = value;
+			}
+		}
+		else
+		{
+			trace.record(from[read], cells[write], false);
+		}
+		int oldValue = board[cells[write]];
+		if (oldValue != value)
+		{
+			changed = true;
+			board[cells[write]] = value;
+			if (emptyCells != NULL)
+			{
+				emptyCells->update(cells[write], oldValue, value);
+			}
+		}
+	}
+	for (; write < N; write++)
+	{
+		int oldValue = board[cells[write]];
+		if (oldValue != 0)
+		{
+			changed = true;
+			board[cells[write]] = 0;
+			if (emptyCells != NULL)
+			{
+				emptyCells->setEmpty(cells[write]);
+			}
+		}
+	}
+	return changed;
+}
+
+//-------------------------------------------------------------------------------------
+// Slide the whole N x N board in the given direction, reporting every tile to trace
+template<int N, int Direction, class Trace>
+bool slideBoardTraced(int board[], int &score, EmptyCells *emptyCells, int *maxTile, Trace &trace)
+{
+	bool changed = false;
+	for (int line = 0; line < N; line++)
+	{
+		changed |= slideLine<N, Direction>(board, line, score, emptyCells, maxTile, trace);
+	}
+	return changed;
+}
+
+//-------------------------------------------------------------------------------------
+// Slide the whole N x N board in the given direction
+template<int N, int Direction>
+bool slideBoardKernel(int board[], int &score, EmptyCells *emptyCells, int *maxTile = NULL)
+{
+	NoTrace noTrace;
+	return slideBoardTraced<N, Direction>(board, score, emptyCells, maxTile, noTrace);
+}
+
+//-------------------------------------------------------------------------------------
+// Whether a move in some direction would change the N x N board.  Looks at every pair
+// of neighbors once: a pair along a row or column allows a move if it holds two equal
+// tiles, or a tile and an empty square the tile could slide into.
+template<int N>
+bool canMoveKernel(const int board[])
+{
+	for (int row = 0; row < N; row++)
+	{
+		for (int col = 0; col < N; col++)
+		{
+			int value = board[row * N + col];
+			if (col + 1 < N)
+			{
+				int right = board[row * N + col + 1];
+				if ((value == right && value != 0) || ((value == 0) != (right == 0)))
+				{
+					return true;
+				}
+			}
+			if (row + 1 < N)
+			{
+				int below = board[(row + 1) * N + col];
+				if ((value == below && value != 0) || ((value == 0) != (below == 0)))
+				{
+					return true;
+				}
+			}
+		}
+	}
+	return false;
+}
+
+//-------------------------------------------------------------------------------------
+// Slide one line both ways at once: towards its first square into forward, and
+// towards its last square into backward.  The tiles are gathered once and merged
+// from each end.  Returns the points scored (the same either way) and sets the two
+// changed flags if any square differs from board.
+template<int N>
+inline int slideLineBothWays(const int board[], const int (&cells)[N], int forward[],
+	int backward[], bool &forwardChanged, bool &backwardChanged)
+{
+	int tiles[N];
+	int count = 0;
+	for (int position = 0; position < N; position++)
+	{
+		int value = board[cells[position]];
+		tiles[count] = value;
+		count += (value != 0);
+	}
+
+	// Merging from the first square
+	int gain = 0;
+	int write = 0;
+	for (int read = 0; read < count; read++, write++)
+	{
+		int value = tiles[read];
+		if (read + 1 < count && tiles[read + 1] == value)
+		{
+			value += value;
+			gain += value;
+			read++;
+		}
+		forwardChanged |= (board[cells[write]] != value);
+		forward[cells[write]] = value;
+	}
+	for (; write < N; write++)
+	{
+		forwardChanged |= (board[cells[write]] != 0);
+		forward[cells[write]] = 0;
+	}
+
+	// Merging from the last square
+	write = N - 1;
+	for (int read = count - 1; read >= 0; read--, write--)
+	{
+		int value = tiles[read];
+		if (read > 0 && tiles[read - 1] == value)
+		{
+			value += value;
+			read--;
+		}
+		backwardChanged |= (board[cells[write]] != value);
+		backward[cells[write]] = value;
+	}
+	for (; write >= 0; write--)
+	{
+		backwardChanged |= (board[cells[write]] != 0);
+		backward[cells[write]] = 0;
+	}
+	return gain;
+}
+
+//-------------------------------------------------------------------------------------
+// All four moves of an N x N board in one pass over its rows and columns.  results,
+// gains and changed are indexed by Direction; results[d] receives the board after
+// moving in direction d, and gains[d] the points it scores.
+template<int N>
+void slideAllKernel(const int board[], int *results[], int gains[], bool changed[])
+{
+	for (int d = 0; d < NumberOfDirections; d++)
+	{
+		gains[d] = 0;
+		changed[d] = false;
+	}
+	for (int line = 0; line < N; line++)
+	{
+		int rowGain = slideLineBothWays<N>(board, BoardKernelTables<N>::lines.cells[DirectionLeft][line],
+			results[DirectionLeft], results[DirectionRight],
+			changed[DirectionLeft], changed[DirectionRight]);
+		int columnGain = slideLineBothWays<N>(board, BoardKernelTables<N>::lines.cells[DirectionUp][line],
+			results[DirectionUp], results[DirectionDown],
+			changed[DirectionUp], changed[DirectionDown]);
+		gains[DirectionLeft] += rowGain;
+		gains[DirectionRight] += rowGain;
+		gains[DirectionUp] += columnGain;
+		gains[DirectionDown] += columnGain;
+	}
+}
+
+// The four successors of a board, as filled in by slideAllDirections()
+struct AllMoves
+{
+	int boards[NumberOfDirections][MaxBoardSize * MaxBoardSize];
+	int gains[NumberOfDirections];
+	bool changed[NumberOfDirections];
+};
+
+bool slideBoard(int board[], int squaresPerSide, Direction direction, int &score,
+	EmptyCells *emptyCells = NULL, int *maxTile = NULL);
+bool slideBoard(int board[], int squaresPerSide, Direction direction, int &score,
+	MoveTrace &trace, EmptyCells *emptyCells = NULL, int *maxTile = NULL);
+void slideAllDirections(const int board[], int squaresPerSide, AllMoves &moves);
+bool hasLegalMove(const int board[], int squaresPerSide);
+
+#endif // BOARDKERNELS_H
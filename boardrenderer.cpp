@@ -0,0 +1,257 @@
+//  boardrenderer.cpp
+//     Batched board drawing.  See boardrenderer.h.
+
+#include "boardrenderer.h"
+#include <algorithm>
+#include <cmath>
+
+// A 4x4 board has 90-pixel tiles 95 pixels apart with 30-point numbers, as it always
+// has.  Larger boards are scaled down to fit the window.
+const float TilePitch = 95;
+const float TileSize = 90;
+const float TextSize = 30;
+
+const sf::Color EmptySquareColor(190, 190, 190);
+const sf::Color TileColor = sf::Color::White;
+
+// Length of each part of a move's animation, and how much larger a merged tile gets
+// at the top of its pop
+const float SlideSeconds = 0.1f;
+const float PopSeconds = 0.1f;
+const float PopGrowth = 0.2f;
+const float Pi = 3.14159265f;
+
+
+//-------------------------------------------------------------------------------------
+BoardRenderer::BoardRenderer(const sf::Font &font, int windowWidth)
+	: font(font), windowWidth(windowWidth), squaresPerSide(0), animating(false)
+{
+	tiles.setPrimitiveType(sf::Quads);
+	digits.setPrimitiveType(sf::Quads);
+}
+
+//-------------------------------------------------------------------------------------
+// Place the squares for a board of the given size, and get the digits at the size
+// its numbers will be drawn
+void BoardRenderer::layOut(int squaresPerSide)
+{
+	this->squaresPerSide = squaresPerSide;
+	int squares = squaresPerSide * squaresPerSide;
+	pitch = std::min(TilePitch, (float)windowWidth / squaresPerSide);
+	tileSize = pitch * TileSize / TilePitch;
+	textSize = (unsigned int)(TextSize * pitch / TilePitch);
+
+	// The backgrounds come first in the array so the tiles are drawn over them
+	tiles.resize(squares * 2 * 4);
+	for (int i = 0; i < squares; i++)
+	{
+		float left = (i % squaresPerSide) * pitch;
+		float top = (i / squaresPerSide) * pitch;
+		sf::Vertex *quad = &tiles[i * 4];
+		quad[0].position = sf::Vector2f(left, top);
+		quad[1].position = sf::Vector2f(left + tileSize, top);
+		quad[2].position = sf::Vector2f(left + tileSize, top + tileSize);
+		quad[3].position = sf::Vector2f(left, top + tileSize);
+		for (int corner = 0; corner < 4; corner++)
+		{
+			quad[corner].color = EmptySquareColor;
+		}
+	}
+
+	// Getting every digit now puts them all in the font's texture before anything is
+	// drawn from it
+	for (int d = 0; d < 10; d++)
+	{
+		glyphs[d] = font.getGlyph('0' + d, textSize, false);
+	}
+	digitsTop = (tileSize - glyphs[0].bounds.height) / 2 - glyphs[0].bounds.top;
+
+	digits.resize(squares * MaxDigits * 4);
+	for (int i = 0; i < squares; i++)
+	{
+		shownValues[i] = -1;
+	}
+}
+
+//-------------------------------------------------------------------------------------
+// Set the tile quad and digit quads of one slot to show value on a tile whose top
+// left corner is at (left, top), scaled about its center.  A slot with a value of 0,
+// and the quads past the last digit, are collapsed to a point so they draw nothing.
+void BoardRenderer::writeTile(int slot, int value, float left, float top, float scale)
+{
+	float centerX = left + tileSize / 2;
+	float centerY = top + tileSize / 2;
+	float half = tileSize * scale / 2;
+	sf::Vertex *quad = &tiles[(squaresPerSide * squaresPerSide + slot) * 4];
+	if (value == 0)
+	{
+		half = 0;
+	}
+	quad[0].position = sf::Vector2f(centerX - half, centerY - half);
+	quad[1].position = sf::Vector2f(centerX + half, centerY - half);
+	quad[2].position = sf::Vector2f(centerX + half, centerY + half);
+	quad[3].position = sf::Vector2f(centerX - half, centerY + half);
+	for (int corner = 0; corner < 4; corner++)
+	{
+		quad[corner].color = TileColor;
+	}
+
+	char text[MaxDigits];
+	int length = 0;
+	for (unsigned int rest = value > 0 ? (unsigned int)value : 0; rest != 0 && length < MaxDigits; rest /= 10)
+	{
+		text[length++] = (char)(rest % 10);
+	}
+	std::reverse(text, text + length);
+
+	// Lay the digits out at full size relative to the tile's center, then scale
+	float width = 0;
+	for (int k = 0; k < length; k++)
+	{
+		width += glyphs[(int)text[k]].advance;
+	}
+	float x = -width / 2;
+	float baseline = digitsTop - tileSize / 2;
+
+	quad = &digits[slot * MaxDigits * 4];
+	for (int k = 0; k < MaxDigits; k++, quad += 4)
+	{
+		if (k >= length)
+		{
+			for (int corner = 0; corner < 4; corner++)
+			{
+				quad[corner].position = sf::Vector2f(0, 0);
+			}
+			continue;
+		}
+		const sf::Glyph &glyph = glyphs[(int)text[k]];
+		float glyphLeft = centerX + (x + glyph.bounds.left) * scale;
+		float glyphTop = centerY + (baseline + glyph.bounds.top) * scale;
+		float right = glyphLeft + glyph.bounds.width * scale;
+		float bottom = glyphTop + glyph.bounds.height * scale;
+		float u = (float)glyph.textureRect.left;
+		float v = (float)glyph.textureRect.top;
+		float uEnd = u + glyph.textureRect.width;
+		float vEnd = v + glyph.textureRect.height;
+		quad[0].position = sf::Vector2f(glyphLeft, glyphTop);
+		quad[1].position = sf::Vector2f(right, glyphTop);
+		quad[2].position = sf::Vector2f(right, bottom);
+		quad[3].position = sf::Vector2f(glyphLeft, bottom);
+		quad[0].texCoords = sf::Vector2f(u, v);
+		quad[1].texCoords = sf::Vector2f(uEnd, v);
+		quad[2].texCoords = sf::Vector2f(uEnd, vEnd);
+		quad[3].texCoords = sf::Vector2f(u, vEnd);
+		for (int corner = 0; corner < 4; corner++)
+		{
+			quad[corner].color = sf::Color::Black;
+		}
+		x += glyph.advance;
+	}
+}
+
+//-------------------------------------------------------------------------------------
+// Start animating the move that led to the next board given to update().  A trace
+// with no tiles in it means there is nothing to animate.
+void BoardRenderer::showMove(const MoveTrace &trace, int spawnSquare)
+{
+	animating = (trace.count > 0);
+	move.count = trace.count;
+	std::copy(trace.moves, trace.moves + trace.count, move.moves);
+	this->spawnSquare = spawnSquare;
+	std::fill(mergedInto, mergedInto + MaxBoardSize * MaxBoardSize, false);
+	for (int i = 0; i < trace.count; i++)
+	{
+		if (trace.moves[i].merged)
+		{
+			mergedInto[trace.moves[i].to] = true;
+		}
+	}
+}
+
+//-------------------------------------------------------------------------------------
+// Draw every tile of the move part of the way, progress from 0 to 1, from the square
+// it came from to the square it went to.  Each tile uses the slot of the square it
+// came from, which no other tile shares.  Its value is the one on the square it went
+// to, or half of it if it merged there.
+void BoardRenderer::writeSlide(const int board[], float progress)
+{
+	int squares = squaresPerSide * squaresPerSide;
+	for (int i = 0; i < squares; i++)
+	{
+		writeTile(i, 0, 0, 0, 1);
+		shownValues[i] = -1;
+	}
+	for (int i = 0; i < move.count; i++)
+	{
+		const TileMove &tile = move.moves[i];
+		float fromLeft = (tile.from % squaresPerSide) * pitch;
+		float fromTop = (tile.from / squaresPerSide) * pitch;
+		float left = fromLeft + ((tile.to % squaresPerSide) * pitch - fromLeft) * progress;
+		float top = fromTop + ((tile.to / squaresPerSide) * pitch - fromTop) * progress;
+		int value = tile.merged ? board[tile.to] / 2 : board[tile.to];
+		writeTile(tile.from, value, left, top, 1);
+	}
+}
+
+//-------------------------------------------------------------------------------------
+// Draw the board after the move, with the merged tiles swelling and shrinking back
+// and the new piece growing to full size as progress goes from 0 to 1
+void BoardRenderer::writePop(const int board[], float progress)
+{
+	for (int i = 0; i < squaresPerSide * squaresPerSide; i++)
+	{
+		float scale = 1;
+		if (i == spawnSquare)
+		{
+			scale = progress;
+		}
+		else if (mergedInto[i])
+		{
+			scale = 1 + PopGrowth * std::sin(Pi * progress);
+		}
+		writeTile(i, board[i], (i % squaresPerSide) * pitch, (i / squaresPerSide) * pitch, scale);
+		shownValues[i] = -1;
+	}
+}
+
+//-------------------------------------------------------------------------------------
+// Bring the tiles up to date with the board, seconds after the last showMove().
+// Once the animation is over only the tiles that changed are touched.
+void BoardRenderer::update(const int board[], int squaresPerSide, float seconds)
+{
+	if (squaresPerSide != this->squaresPerSide)
+	{
+		layOut(squaresPerSide);
+		animating = false;
+	}
+	if (animating && seconds < SlideSeconds)
+	{
+		writeSlide(board, seconds / SlideSeconds);
+		return;
+	}
+	if (animating && seconds < SlideSeconds + PopSeconds)
+	{
+		writePop(board, (seconds - SlideSeconds) / PopSeconds);
+		return;
+	}
+	animating = false;
+	for (int i = 0; i < squaresPerSide * squaresPerSide; i++)
+	{
+		if (board[i] != shownValues[i])
+		{
+			writeTile(i, board[i], (i % squaresPerSide) * pitch, (i / squaresPerSide) * pitch, 1);
+			shownValues[i] = board[i];
+		}
+	}
+}
+
+//-------------------------------------------------------------------------------------
+void BoardRenderer::draw(sf::RenderWindow &window) const
+{
+	if (squaresPerSide == 0)
+	{
+		return;
+	}
+	window.draw(tiles);
+	window.draw(digits, sf::RenderStates(&font.getTexture(textSize)));
+}
@@ -0,0 +1,61 @@
+//  boardrenderer.h
+//     Draws the board in the SFML window with two draw calls per frame, however big
+//     the board: one vertex array holds a quad for the background of every square and
+//     another for every tile on top of it, and a second holds a textured quad for
+//     every digit of every tile's number, cut from the glyphs the font has already
+//     rendered into its texture.
+//
+//     update() compares the board with the values the tiles show and rewrites the
+//     vertices of only the tiles that changed, so a frame in which nothing moved costs
+//     just the two draws.  The layout is only worked out again when the board size
+//     changes.
+//
+//     showMove() animates the move that led to the board from the move's trace: for
+//     the first SlideSeconds every tile slides from where it was to where it went,
+//     then the merged tiles pop and the new piece grows in.  During the animation each
+//     frame repositions the tiles from the trace alone, without looking at anything
+//     but the final board.
+
+#ifndef BOARDRENDERER_H
+#define BOARDRENDERER_H
+
+#include <SFML/Graphics.hpp>
+#include "board.h"
+#include "boardkernels.h"
+
+class BoardRenderer
+{
+public:
+	BoardRenderer(const sf::Font &font, int windowWidth);
+
+	void showMove(const MoveTrace &trace, int spawnSquare);
+	void update(const int board[], int squaresPerSide, float seconds = 0);
+	void draw(sf::RenderWindow &window) const;
+
+private:
+	static const int MaxDigits = 10;   // Digits in the largest int
+
+	void layOut(int squaresPerSide);
+	void writeTile(int slot, int value, float left, float top, float scale);
+	void writeSlide(const int board[], float progress);
+	void writePop(const int board[], float progress);
+
+	const sf::Font &font;
+	int windowWidth;
+	int squaresPerSide;          // Board size the layout is for, 0 before the first update()
+	float pitch;                 // Distance from one tile to the next
+	float tileSize;
+	unsigned int textSize;
+	float digitsTop;             // Offset of the digits' baseline from the top of a tile
+	sf::Glyph glyphs[10];        // The digits '0' to '9' at textSize
+	int shownValues[MaxBoardSize * MaxBoardSize];   // Value each tile shows, -1 if none yet
+	sf::VertexArray tiles;       // Four corners per square's background, then per tile
+	sf::VertexArray digits;      // Four corners per digit, MaxDigits per tile
+
+	bool animating;              // A move given to showMove() is still being animated
+	MoveTrace move;              // The move being animated
+	int spawnSquare;
+	bool mergedInto[MaxBoardSize * MaxBoardSize];   // Squares where two tiles merged in the move
+};
+
+#endif // BOARDRENDERER_H
@@ -0,0 +1,86 @@
+//  emptycells.h
+//     Set of the empty squares on a board, kept up to date by the move kernels so a
+//     new piece can be placed with a single random pick instead of guessing squares
+//     until an empty one turns up.
+//
+//     The set is a swap-remove free list: cells[0 .. numberEmpty-1] holds the indexes
+//     of the empty squares in no particular order, and slot[index] says where square
+//     index is in that list (or -1 if it is occupied).  Adding, removing and picking
+//     the k-th empty square are all O(1).
+
+#ifndef EMPTYCELLS_H
+#define EMPTYCELLS_H
+
+#include "board.h"
+
+class EmptyCells
+{
+public:
+	EmptyCells() { numberEmpty = 0; }
+
+	// Rebuild the set from scratch, for after the whole board has been replaced
+	void reset(const int board[], int squaresPerSide)
+	{
+		numberEmpty = 0;
+		for (int i = 0; i < squaresPerSide * squaresPerSide; i++)
+		{
+			if (board[i] == 0)
+			{
+				slot[i] = numberEmpty;
+				cells[numberEmpty++] = i;
+			}
+			else
+			{
+				slot[i] = -1;
+			}
+		}
+	}
+
+	// Record that square index is now empty
+	void setEmpty(int index)
+	{
+		if (slot[index] < 0)
+		{
+			slot[index] = numberEmpty;
+			cells[numberEmpty++] = index;
+		}
+	}
+
+	// Record that square index now holds a piece.  The last empty square in the
+	// list takes its place, so nothing has to be shifted.
+	void setFilled(int index)
+	{
+		int position = slot[index];
+		if (position >= 0)
+		{
+			int last = cells[--numberEmpty];
+			cells[position] = last;
+			slot[last] = position;
+			slot[index] = -1;
+		}
+	}
+
+	// Update the set for a square whose value changed from oldValue to newValue
+	void update(int index, int oldValue, int newValue)
+	{
+		if (oldValue == 0 && newValue != 0)
+		{
+			setFilled(index);
+		}
+		else if (oldValue != 0 && newValue == 0)
+		{
+			setEmpty(index);
+		}
+	}
+
+	int count() const { return numberEmpty; }
+	int cell(int i) const { return cells[i]; }   // The i-th empty square, 0 <= i < count()
+	bool isEmpty(int index) const { return slot[index] >= 0; }
+
+private:
+	int cells[MaxBoardSize * MaxBoardSize];   // Indexes of the empty squares
+	int slot[MaxBoardSize * MaxBoardSize];    // Position of each square in cells, or -1
+	int numberEmpty;                          // Number of entries used in cells
+};
+
+#endif // EMPTYCELLS_H
@@ -0,0 +1,282 @@
+//  engineapi.cpp
+//     Plain C interface to the game engine.  See engineapi.h.
+
+#include "engineapi.h"
+#include "game.h"
+#include "history.h"
+#include "bitboard.h"
+#include <vector>
+#include <mutex>
+#include <new>
+
+struct G1024Env
+{
+	int numberOfGames;
+	int squaresPerSide;
+	uint64_t seed;
+	unsigned flags;
+	std::vector<Game> games;
+	std::vector<uint64_t> gamesStarted;   // Games started in each slot, so each new one is different
+	std::vector<GameHistory> histories;   // One per game with G1024_KEEP_HISTORY, otherwise empty
+};
+
+static std::once_flag tablesInitialized;
+
+
+//-------------------------------------------------------------------------------------
+// Write a game's board into the caller's buffer, if there is one
+static void writeObservation(const G1024Env &env, const Game &game, int32_t *observation)
+{
+	if (observation == NULL)
+	{
+		return;
+	}
+	int squares = env.squaresPerSide * env.squaresPerSide;
+	if (env.flags & G1024_OBSERVE_EXPONENTS)
+	{
+		for (int i = 0; i < squares; i++)
+		{
+			int exponent = 0;
+			for (int value = game.board[i]; value > 1; value >>= 1)
+			{
+				exponent++;
+			}
+			observation[i] = exponent;
+		}
+	}
+	else
+	{
+		for (int i = 0; i < squares; i++)
+		{
+			observation[i] = game.board[i];
+		}
+	}
+}
+
+//-------------------------------------------------------------------------------------
+// Start the next game of a slot.  Slot g's k-th game is game k * numberOfGames + g of
+// the environment's seed, so no two games of an environment are the same.
+static void startGame(G1024Env &env, int slot)
+{
+	Game &game = env.games[slot];
+	newGame(game, env.squaresPerSide, env.seed,
+		env.gamesStarted[slot] * (uint64_t)env.numberOfGames + slot);
+	env.gamesStarted[slot]++;
+	if (env.flags & G1024_KEEP_HISTORY)
+	{
+		env.histories[slot].start(game);
+	}
+}
+
+//-------------------------------------------------------------------------------------
+// Make a move in one game.  Returns 1 if the board changed, 0 if it did not, or
+// G1024_ERROR_OUT_OF_MEMORY if the move was made but the history had no room for it.
+static int stepGame(G1024Env &env, int slot, int action, int32_t *observation,
+	int32_t *reward, uint8_t *done)
+{
+	Game &game = env.games[slot];
+	int oldScore = game.score;
+	int status = makeMove(game, (Direction)action) ? 1 : 0;
+	if (status == 1 && (env.flags & G1024_KEEP_HISTORY))
+	{
+		// Exceptions must not get out through the C interface
+		try
+		{
+			env.histories[slot].recordMove((Direction)action, game);
+		}
+		catch (const std::bad_alloc &)
+		{
+			// The history may hold part of the move.  Start it again from here, which
+			// takes no more memory than it already has.
+			env.histories[slot].start(game);
+			status = G1024_ERROR_OUT_OF_MEMORY;
+		}
+	}
+	writeObservation(env, game, observation);
+	if (reward != NULL)
+	{
+		*reward = game.score - oldScore;
+	}
+	if (done != NULL)
+	{
+		*done = hasLegalMove(game) ? 0 : 1;
+	}
+	return status;
+}
+
+//-------------------------------------------------------------------------------------
+int g1024_version(void)
+{
+	return G1024_API_VERSION;
+}
+
+//-------------------------------------------------------------------------------------
+G1024Env *g1024_create(int numberOfGames, int squaresPerSide, uint64_t seed, unsigned flags)
+{
+	if (numberOfGames < 1 || squaresPerSide < MinBoardSize || squaresPerSide > MaxBoardSize)
+	{
+		return NULL;
+	}
+	std::call_once(tablesInitialized, initializeBitboardTables);
+
+	// Exceptions must not get out through the C interface
+	G1024Env *env = new (std::nothrow) G1024Env;
+	if (env == NULL)
+	{
+		return NULL;
+	}
+	try
+	{
+		env->numberOfGames = numberOfGames;
+		env->squaresPerSide = squaresPerSide;
+		env->seed = seed;
+		env->flags = flags;
+		env->games.resize(numberOfGames);
+		env->gamesStarted.assign(numberOfGames, 0);
+		if (flags & G1024_KEEP_HISTORY)
+		{
+			env->histories.resize(numberOfGames);
+		}
+		for (int g = 0; g < numberOfGames; g++)
+		{
+			startGame(*env, g);
+		}
+	}
+	catch (const std::bad_alloc &)
+	{
+		delete env;
+		return NULL;
+	}
+	return env;
+}
+
+//-------------------------------------------------------------------------------------
+void g1024_destroy(G1024Env *env)
+{
+	delete env;
+}
+
+//-------------------------------------------------------------------------------------
+int g1024_observation_size(const G1024Env *env)
+{
+	if (env == NULL)
+	{
+		return G1024_ERROR_ARGUMENT;
+	}
+	return env->squaresPerSide * env->squaresPerSide;
+}
+
+//-------------------------------------------------------------------------------------
+int g1024_number_of_games(const G1024Env *env)
+{
+	if (env == NULL)
+	{
+		return G1024_ERROR_ARGUMENT;
+	}
+	return env->numberOfGames;
+}
+
+//-------------------------------------------------------------------------------------
+int g1024_reset(G1024Env *env, int game, int32_t *observation)
+{
+	if (env == NULL || game < -1 || game >= env->numberOfGames)
+	{
+		return G1024_ERROR_ARGUMENT;
+	}
+	if (game >= 0)
+	{
+		startGame(*env, game);
+		writeObservation(*env, env->games[game], observation);
+		return G1024_OK;
+	}
+
+	int squares = env->squaresPerSide * env->squaresPerSide;
+	for (int g = 0; g < env->numberOfGames; g++)
+	{
+		startGame(*env, g);
+		writeObservation(*env, env->games[g], observation != NULL ? observation + (size_t)g * squares : NULL);
+	}
+	return G1024_OK;
+}
+
+//-------------------------------------------------------------------------------------
+int g1024_step(G1024Env *env, int game, int action, int32_t *observation,
+	int32_t *reward, uint8_t *done)
+{
+	if (env == NULL || game < 0 || game >= env->numberOfGames
+		|| action < 0 || action >= NumberOfDirections)
+	{
+		return G1024_ERROR_ARGUMENT;
+	}
+	return stepGame(*env, game, action, observation, reward, done);
+}
+
+//-------------------------------------------------------------------------------------
+int g1024_step_batch(G1024Env *env, const uint8_t *actions, int32_t *observations,
+	int32_t *rewards, uint8_t *done)
+{
+	if (env == NULL || actions == NULL)
+	{
+		return G1024_ERROR_ARGUMENT;
+	}
+	for (int g = 0; g < env->numberOfGames; g++)
+	{
+		if (actions[g] >= NumberOfDirections)
+		{
+			return G1024_ERROR_ARGUMENT;
+		}
+	}
+
+	int squares = env->squaresPerSide * env->squaresPerSide;
+	int result = G1024_OK;
+	for (int g = 0; g < env->numberOfGames; g++)
+	{
+		if (stepGame(*env, g, actions[g],
+			observations != NULL ? observations + (size_t)g * squares : NULL,
+			rewards != NULL ? rewards + g : NULL,
+			done != NULL ? done + g : NULL) == G1024_ERROR_OUT_OF_MEMORY)
+		{
+			result = G1024_ERROR_OUT_OF_MEMORY;
+		}
+	}
+	return result;
+}
+
+//-------------------------------------------------------------------------------------
+int g1024_undo(G1024Env *env, int game, int32_t *observation)
+{
+	if (env == NULL || game < 0 || game >= env->numberOfGames)
+	{
+		return G1024_ERROR_ARGUMENT;
+	}
+	if (!(env->flags & G1024_KEEP_HISTORY))
+	{
+		return G1024_ERROR_NO_HISTORY;
+	}
+	if (!env->histories[game].undo(env->games[game]))
+	{
+		return G1024_ERROR_NOTHING_TO_UNDO;
+	}
+	writeObservation(*env, env->games[game], observation);
+	return G1024_OK;
+}
+
+//-------------------------------------------------------------------------------------
+int g1024_score(const G1024Env *env, int game)
+{
+	if (env == NULL || game < 0 || game >= env->numberOfGames)
+	{
+		return G1024_ERROR_ARGUMENT;
+	}
+	return env->games[game].score;
+}
+
+//-------------------------------------------------------------------------------------
+int g1024_max_tile(const G1024Env *env, int game)
+{
+	if (env == NULL || game < 0 || game >= env->numberOfGames)
+	{
+		return G1024_ERROR_ARGUMENT;
+	}
+	return maxTileValue(env->games[game]);
+}
@@ -0,0 +1,107 @@
+//  engineapi.h
+//     Plain C interface to the game engine, for programs that drive games from
+//     another language (training pipelines calling through a foreign function
+//     interface).  Nothing here uses SFML: the library is built from
+//        engineapi.cpp game.cpp board.cpp boardkernels.cpp bitboard.cpp history.cpp
+//        metrics.cpp
+//     for instance with
+//        g++ -std=c++14 -O2 -shared -fPIC -pthread -o lib1024.so engineapi.cpp game.cpp
+//            board.cpp boardkernels.cpp bitboard.cpp history.cpp metrics.cpp
+//     and on Windows by compiling the same files into a DLL with G1024_BUILD_LIBRARY
+//     defined.  metrics.cpp is empty unless G1024_METRICS is defined, in which case
+//     the engine's counters are compiled into the library too (see metrics.h).
+//
+//     An environment holds a fixed number of games of one board size.  Every call
+//     that produces output writes it straight into buffers owned by the caller, so
+//     the caller can hand in views of its own arrays and nothing is allocated or
+//     copied a second time per step.  An observation is one int32 per square, row by
+//     row: the tile values, or with G1024_OBSERVE_EXPONENTS their base-2 exponents
+//     (0 for an empty square, 1 for a 2, ...).  Batch calls fill game g's part of a
+//     buffer at observations + g * g1024_observation_size(env).  Any output pointer
+//     may be NULL when that output is not wanted.
+//
+//     Functions return G1024_OK (or, for the steps, whether the move changed the
+//     board) or one of the negative G1024_ERROR codes.  Environments are not
+//     thread-safe, but separate environments can be used on separate threads.
+
+#ifndef ENGINEAPI_H
+#define ENGINEAPI_H
+
+#include <stdint.h>
+
+#if defined(_WIN32)
+#ifdef G1024_BUILD_LIBRARY
+#define G1024_API __declspec(dllexport)
+#else
+#define G1024_API __declspec(dllimport)
+#endif
+#elif defined(__GNUC__)
+#define G1024_API __attribute__((visibility("default")))
+#else
+#define G1024_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define G1024_API_VERSION 1
+
+// Flags for g1024_create()
+#define G1024_OBSERVE_EXPONENTS 0x1   // Observations hold exponents rather than tile values
+#define G1024_KEEP_HISTORY      0x2   // Record every move so g1024_undo() can take it back
+
+// Results
+#define G1024_OK                   0
+#define G1024_ERROR_ARGUMENT      -1   // No environment, or a game, action or size out of range
+#define G1024_ERROR_NO_HISTORY    -2   // g1024_undo() on an environment made without G1024_KEEP_HISTORY
+#define G1024_ERROR_NOTHING_TO_UNDO -3 // g1024_undo() at the start of a game
+#define G1024_ERROR_OUT_OF_MEMORY -4   // A move was made, but with G1024_KEEP_HISTORY it cannot be undone
+
+// Actions, the same as the engine's Direction
+#define G1024_LEFT  0
+#define G1024_RIGHT 1
+#define G1024_UP    2
+#define G1024_DOWN  3
+
+typedef struct G1024Env G1024Env;
+
+G1024_API int g1024_version(void);
+
+// New environment of numberOfGames games, all started.  Returns NULL if the
+// arguments are out of range or there is not enough memory.
+G1024_API G1024Env *g1024_create(int numberOfGames, int squaresPerSide, uint64_t seed, unsigned flags);
+G1024_API void g1024_destroy(G1024Env *env);
+
+G1024_API int g1024_observation_size(const G1024Env *env);
+G1024_API int g1024_number_of_games(const G1024Env *env);
+
+// Start a new game in slot game, or in every slot if game is -1 (observation then
+// holds every game's observation)
+G1024_API int g1024_reset(G1024Env *env, int game, int32_t *observation);
+
+// Make one move in one game.  Returns 1 if the move changed the board, 0 if it did
+// not (the game is then unchanged and the reward is 0), or an error.  done is set to
+// 1 when no move is left to make.  With G1024_KEEP_HISTORY, G1024_ERROR_OUT_OF_MEMORY
+// means the move was made and the outputs are set, but there was no memory to record
+// it: the history then starts again from the new position.
+G1024_API int g1024_step(G1024Env *env, int game, int action, int32_t *observation,
+	int32_t *reward, uint8_t *done);
+
+// Make one move in every game, actions[g] for game g.  Games that are over are left
+// as they are until they are reset.  Every game is stepped even if one of them
+// returns G1024_ERROR_OUT_OF_MEMORY, which is then returned.
+G1024_API int g1024_step_batch(G1024Env *env, const uint8_t *actions, int32_t *observations,
+	int32_t *rewards, uint8_t *done);
+
+// Take back the last move of a game, with G1024_KEEP_HISTORY
+G1024_API int g1024_undo(G1024Env *env, int game, int32_t *observation);
+
+G1024_API int g1024_score(const G1024Env *env, int game);
+G1024_API int g1024_max_tile(const G1024Env *env, int game);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ENGINEAPI_H
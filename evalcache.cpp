@@ -0,0 +1,330 @@
+//  evalcache.cpp
+//     Evaluation cache file.  See evalcache.h.
+
+#include "evalcache.h"
+#include "board.h"
+#include "boardkernels.h"
+#include "gamerng.h"
+#include <cstring>
+#include <algorithm>
+#include <thread>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+const uint64_t UsedBit = (uint64_t)1 << 63;   // Set in the data word of every slot in use
+const int MinLog2Slots = 10;
+const int MaxLog2Slots = 32;
+const int FingerprintBoards = 64;             // Boards slid by slideRulesFingerprint()
+const uint64_t FingerprintSeed = 1024;
+const int CheckWordSpins = 1000;              // Yields to wait for another writer's check word
+
+
+//-------------------------------------------------------------------------------------
+// SplitMix64 finalizer, to fold the slide results into a fingerprint
+static uint64_t mixFingerprint(uint64_t z)
+{
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+//-------------------------------------------------------------------------------------
+// Fingerprint of the game's rules on boards of the given size: a hash of the boards
+// and points slideBoard() gives for every direction on a fixed set of random boards.
+// Any change to how tiles slide, merge or score changes it.
+uint64_t slideRulesFingerprint(int squaresPerSide)
+{
+	int squares = squaresPerSide * squaresPerSide;
+	GameRng rng(FingerprintSeed, squaresPerSide);
+	uint64_t fingerprint = mixFingerprint(squaresPerSide);
+	for (int b = 0; b < FingerprintBoards; b++)
+	{
+		int board[MaxBoardSize * MaxBoardSize];
+		for (int i = 0; i < squares; i++)
+		{
+			// Few distinct tiles, so many of them merge
+			board[i] = (rng.nextBelow(3) == 0) ? 0 : 2 << rng.nextBelow(4);
+		}
+		for (int d = 0; d < NumberOfDirections; d++)
+		{
+			int slid[MaxBoardSize * MaxBoardSize];
+			copyBoard(board, slid, squaresPerSide);
+			int score = 0;
+			bool changed = slideBoard(slid, squaresPerSide, (Direction)d, score);
+			fingerprint = mixFingerprint(fingerprint ^ (uint64_t)score ^ ((uint64_t)changed << 32));
+			for (int i = 0; i < squares; i++)
+			{
+				fingerprint = mixFingerprint(fingerprint ^ (uint32_t)slid[i]);
+			}
+		}
+	}
+	return fingerprint;
+}
+
+//-------------------------------------------------------------------------------------
+// Name used for a status in reports
+const char *evalCacheStatusName(EvalCacheStatus status)
+{
+	static const char *Names[NumberOfEvalCacheStatuses] = {
+		"opened", "created", "unavailable", "wrong_format", "wrong_board", "wrong_rules"
+	};
+	return Names[status];
+}
+
+//-------------------------------------------------------------------------------------
+// Data word of an entry
+static uint64_t packEntry(double value, int depth, int bestMove)
+{
+	float stored = (float)value;
+	uint32_t bits;
+	memcpy(&bits, &stored, sizeof(bits));
+	return UsedBit | bits | (uint64_t)std::min(depth, 0xFF) << 32 | (uint64_t)(bestMove & 0xFF) << 40;
+}
+
+//-------------------------------------------------------------------------------------
+// Wait, briefly, for the writer that just claimed a slot to store the slot's check
+// word, slot[0], which it writes once its data word, slot[1], is in.  A writer that
+// died in between leaves the check word 0, and the slot then simply never matches.
+static void waitForCheckWord(const std::atomic<uint64_t> &check)
+{
+	for (int spin = 0; spin < CheckWordSpins && check.load(std::memory_order_acquire) == 0; spin++)
+	{
+		std::this_thread::yield();
+	}
+}
+
+//-------------------------------------------------------------------------------------
+static size_t fileSize(int log2Slots)
+{
+	return EvalCacheHeaderSize + ((size_t)2 * sizeof(uint64_t) << log2Slots);
+}
+
+
+//-------------------------------------------------------------------------------------
+EvaluationCache::EvaluationCache()
+	: mapped(NULL), size(0), slots(NULL), mask(0), hits(0), misses(0), stores(0)
+{
+}
+
+#ifndef _WIN32
+
+//-------------------------------------------------------------------------------------
+// Open the cache file at path for boards of the given size, making it with
+// 2^log2Slots empty slots if it does not exist yet.  An existing file keeps its
+// own number of slots, but must have been made for the same board size, scoring
+// rules and evaluation; if not, it is left as it is and the cache stays closed.
+EvalCacheStatus EvaluationCache::open(const char *path, int squaresPerSide,
+	uint64_t evaluatorFingerprint, int log2Slots)
+{
+	close();
+	if (squaresPerSide < MinBoardSize || squaresPerSide > MaxBoardSize
+		|| log2Slots < MinLog2Slots || log2Slots > MaxLog2Slots)
+	{
+		return EvalCacheUnavailable;
+	}
+	int fd = ::open(path, O_RDWR | O_CREAT, 0644);
+	if (fd < 0)
+	{
+		return EvalCacheUnavailable;
+	}
+	// Another process may be making the same file right now
+	flock(fd, LOCK_EX);
+
+	EvalCacheHeader expected;
+	memset(&expected, 0, sizeof(expected));
+	expected.magic = EvalCacheMagic;
+	expected.version = EvalCacheVersion;
+	expected.squaresPerSide = squaresPerSide;
+	expected.log2Slots = log2Slots;
+	expected.rulesFingerprint = slideRulesFingerprint(squaresPerSide);
+	expected.evaluatorFingerprint = evaluatorFingerprint;
+
+	EvalCacheStatus status = EvalCacheOpened;
+	EvalCacheHeader found;
+	struct stat info;
+	if (fstat(fd, &info) != 0)
+	{
+		status = EvalCacheUnavailable;
+	}
+	else if (info.st_size == 0)
+	{
+		// A new file: the slots start out as zeros, that is empty
+		status = EvalCacheCreated;
+		if (ftruncate(fd, (off_t)fileSize(log2Slots)) != 0
+			|| pwrite(fd, &expected, sizeof(expected), 0) != (ssize_t)sizeof(expected))
+		{
+			status = EvalCacheUnavailable;
+		}
+	}
+	else if (pread(fd, &found, sizeof(found), 0) != (ssize_t)sizeof(found)
+		|| found.magic != EvalCacheMagic || found.version != EvalCacheVersion
+		|| found.log2Slots < (uint32_t)MinLog2Slots || found.log2Slots > (uint32_t)MaxLog2Slots
+		|| (size_t)info.st_size != fileSize(found.log2Slots))
+	{
+		status = EvalCacheWrongFormat;
+	}
+	else if (found.squaresPerSide != (uint32_t)squaresPerSide)
+	{
+		status = EvalCacheWrongBoard;
+	}
+	else if (found.rulesFingerprint != expected.rulesFingerprint
+		|| found.evaluatorFingerprint != expected.evaluatorFingerprint)
+	{
+		status = EvalCacheWrongRules;
+	}
+	else
+	{
+		log2Slots = (int)found.log2Slots;
+	}
+
+	if (status == EvalCacheOpened || status == EvalCacheCreated)
+	{
+		size_t length = fileSize(log2Slots);
+		void *region = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if (region == MAP_FAILED)
+		{
+			status = EvalCacheUnavailable;
+		}
+		else
+		{
+			// Lookups jump all over the file, so reading ahead would only waste time
+			madvise(region, length, MADV_RANDOM);
+			mapped = region;
+			size = length;
+			slots = (std::atomic<uint64_t> *)((char *)region + EvalCacheHeaderSize);
+			mask = ((uint64_t)1 << log2Slots) - 1;
+		}
+	}
+	flock(fd, LOCK_UN);
+	::close(fd);   // The mapping stays valid without the descriptor
+	return status;
+}
+
+//-------------------------------------------------------------------------------------
+void EvaluationCache::close()
+{
+	if (mapped != NULL)
+	{
+		munmap(mapped, size);
+	}
+	mapped = NULL;
+	size = 0;
+	slots = NULL;
+	mask = 0;
+}
+
+#else
+
+//-------------------------------------------------------------------------------------
+// The cache file is mapped with POSIX calls, which Windows does not have
+EvalCacheStatus EvaluationCache::open(const char *path, int squaresPerSide,
+	uint64_t evaluatorFingerprint, int log2Slots)
+{
+	return EvalCacheUnavailable;
+}
+
+void EvaluationCache::close()
+{
+}
+
+#endif
+
+//-------------------------------------------------------------------------------------
+// Value of the position with the given key and its best move, if they were stored,
+// by this process or any other, after a search at least depth chance layers deep
+bool EvaluationCache::lookup(uint64_t key, int depth, double &value, int &bestMove) const
+{
+	if (slots == NULL)
+	{
+		return false;
+	}
+	for (int probe = 0; probe < MaxProbes; probe++)
+	{
+		const std::atomic<uint64_t> *slot = slots + 2 * ((key + probe) & mask);
+		uint64_t data = slot[1].load(std::memory_order_acquire);
+		if (data == 0)
+		{
+			break;   // Keys are never stored past an empty slot
+		}
+		if ((slot[0].load(std::memory_order_relaxed) ^ data) == key)
+		{
+			if ((int)((data >> 32) & 0xFF) < depth)
+			{
+				break;
+			}
+			uint32_t bits = (uint32_t)data;
+			float stored;
+			memcpy(&stored, &bits, sizeof(stored));
+			value = stored;
+			bestMove = (int)((data >> 40) & 0xFF);
+			hits.fetch_add(1, std::memory_order_relaxed);
+			return true;
+		}
+	}
+	misses.fetch_add(1, std::memory_order_relaxed);
+	return false;
+}
+
+//-------------------------------------------------------------------------------------
+// Store a position's value and best move, in the slot already holding the key if
+// it was searched no deeper before, or else in the first empty slot.  If the key's
+// MaxProbes slots are all taken by other keys, the entry is dropped.
+void EvaluationCache::store(uint64_t key, int depth, double value, int bestMove)
+{
+	if (slots == NULL)
+	{
+		return;
+	}
+	uint64_t entry = packEntry(value, depth, bestMove);
+	for (int probe = 0; probe < MaxProbes; probe++)
+	{
+		std::atomic<uint64_t> *slot = slots + 2 * ((key + probe) & mask);
+		uint64_t data = slot[1].load(std::memory_order_acquire);
+		if (data == 0)
+		{
+			if (slot[1].compare_exchange_strong(data, entry, std::memory_order_acq_rel))
+			{
+				slot[0].store(key ^ entry, std::memory_order_release);
+				stores.fetch_add(1, std::memory_order_relaxed);
+				return;
+			}
+			// Another writer took the slot first, perhaps for this same key, so it is
+			// checked like any other taken slot once the writer's check word is in
+			waitForCheckWord(slot[0]);
+		}
+		if ((slot[0].load(std::memory_order_acquire) ^ data) == key)
+		{
+			// Replace the data word only if it is still the one read, so two writers
+			// updating the key at once cannot leave one's data with the other's check
+			// word.  The writer that loses keeps the other's entry.
+			if ((int)((data >> 32) & 0xFF) <= depth
+				&& slot[1].compare_exchange_strong(data, entry, std::memory_order_acq_rel))
+			{
+				slot[0].store(key ^ entry, std::memory_order_release);
+				stores.fetch_add(1, std::memory_order_relaxed);
+			}
+			return;
+		}
+	}
+}
+
+//-------------------------------------------------------------------------------------
+// Number of slots in use, by any process
+int64_t EvaluationCache::countEntries() const
+{
+	int64_t count = 0;
+	if (slots != NULL)
+	{
+		for (uint64_t s = 0; s <= mask; s++)
+		{
+			count += (slots[2 * s + 1].load(std::memory_order_relaxed) != 0);
+		}
+	}
+	return count;
+}
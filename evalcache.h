@@ -0,0 +1,99 @@
+//  evalcache.h
+//     Evaluations kept in a file across runs, so a search started again on the same
+//     openings and positions finds its earlier results instead of searching again.
+//
+//     The file is an EvalCacheHeader followed by 2^log2Slots slots, and is mapped
+//     into memory whole when opened, so opening takes no time whatever the file's
+//     size, and several processes on the same machine can use one file at once.
+//     Positions are keyed by canonicalHash() (see zobrist.h), so a position and its
+//     rotations and reflections share a slot.  A key's first slot is picked by its
+//     low bits, and it goes in that slot or one of the next MaxProbes - 1.
+//
+//     Each slot is two 64-bit words: the entry's key XORed with its data, then the
+//     data, as in the expectimax transposition table.  An empty slot is claimed, and
+//     a stored entry replaced, with a compare-and-swap on its data word, so two
+//     writers never take the same slot for different keys, nor mix their words in
+//     one slot.  The numbers are in the machine's own byte order.
+//
+//     The header records the board size, and fingerprints of the scoring rules (the
+//     boards and points the slide functions give on a fixed set of boards) and of the
+//     evaluation whose results are stored.  A file whose header does not match is
+//     left alone and not used.
+
+#ifndef EVALCACHE_H
+#define EVALCACHE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "The cache needs lock-free atomics to work across processes");
+
+const uint32_t EvalCacheMagic = 0x434B3147;   // "G1KC"
+const uint32_t EvalCacheVersion = 1;
+const int EvalCacheHeaderSize = 64;           // Keeps the slots on cache-line boundaries
+
+struct EvalCacheHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t squaresPerSide;
+	uint32_t log2Slots;
+	uint64_t rulesFingerprint;       // slideRulesFingerprint() of the board size
+	uint64_t evaluatorFingerprint;   // Of the evaluation stored, chosen by the caller
+	uint8_t unused[32];
+};
+
+static_assert(sizeof(EvalCacheHeader) == EvalCacheHeaderSize, "The header must fill its space exactly");
+
+// What EvaluationCache::open() found
+enum EvalCacheStatus
+{
+	EvalCacheOpened,         // An existing cache file was opened
+	EvalCacheCreated,        // A new, empty cache file was made
+	EvalCacheUnavailable,    // The file could not be opened, made or mapped
+	EvalCacheWrongFormat,    // Not a cache file, or one from another version
+	EvalCacheWrongBoard,     // Made for another board size
+	EvalCacheWrongRules,     // Made with other scoring rules or another evaluation
+	NumberOfEvalCacheStatuses
+};
+
+//-------------------------------------------------------------------------------------
+class EvaluationCache
+{
+public:
+	static const int DefaultLog2Slots = 20;   // A 16 MB file
+	static const int MaxProbes = 16;          // Slots a key may be stored in
+
+	EvaluationCache();
+	~EvaluationCache() { close(); }
+
+	EvalCacheStatus open(const char *path, int squaresPerSide, uint64_t evaluatorFingerprint,
+		int log2Slots = DefaultLog2Slots);
+	void close();
+	bool isOpen() const { return slots != NULL; }
+
+	bool lookup(uint64_t key, int depth, double &value, int &bestMove) const;
+	void store(uint64_t key, int depth, double value, int bestMove);
+
+	int64_t countEntries() const;
+	int64_t getHits() const { return hits.load(std::memory_order_relaxed); }
+	int64_t getMisses() const { return misses.load(std::memory_order_relaxed); }
+	int64_t getStores() const { return stores.load(std::memory_order_relaxed); }
+
+private:
+	void *mapped;                     // The whole file, header first
+	size_t size;
+	std::atomic<uint64_t> *slots;     // Slot s at slots[2 * s], just after the header
+	uint64_t mask;                    // Slots - 1
+
+	// Counts for this process alone
+	mutable std::atomic<int64_t> hits;
+	mutable std::atomic<int64_t> misses;
+	std::atomic<int64_t> stores;
+};
+
+uint64_t slideRulesFingerprint(int squaresPerSide);
+const char *evalCacheStatusName(EvalCacheStatus status);
+
+#endif // EVALCACHE_H
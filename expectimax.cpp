@@ -0,0 +1,631 @@
+//  expectimax.cpp
+//     Expectimax search.  See expectimax.h.
+
+#include "expectimax.h"
+#include "bitboard.h"
+#include "boardkernels.h"
+#include "zobrist.h"
+#include "evalcache.h"
+#include "ntuple.h"
+#include "gamerng.h"
+#include <cmath>
+#include <algorithm>
+#include <mutex>
+#include <climits>
+#include <cstring>
+
+// Weights of the position heuristic.  A line scores well when it has empty squares,
+// tiles that can be merged, and tiles that increase or decrease steadily along it.
+const double LostPenalty = 200000.0;        // Added to every line, so any live position beats a lost one
+const double EmptyWeight = 270.0;
+const double MergesWeight = 700.0;
+const double MonotonicityPower = 4.0;
+const double MonotonicityWeight = 47.0;
+const double SumPower = 3.5;
+const double SumWeight = 11.0;
+
+const int MaxExponent = 31;                 // Largest tile exponent an int board can hold
+const int CacheLineWords = 8;               // 64-bit words in a cache line, the size of a bucket
+const int AgeWeight = 4;                    // Depth an entry is worth less for each search since it was stored
+const uint64_t RootKey = 0x52F1A0C3B94D6E17ULL;   // XORed into root keys, so they never match a chance node's
+const int FingerprintLines = 16;            // Lines of each length expectimaxFingerprint() evaluates
+const uint64_t FingerprintSeed = 1024;
+
+static double MonotonicityTable[MaxExponent + 1];   // exponent ^ MonotonicityPower
+static double SumTable[MaxExponent + 1];            // exponent ^ SumPower
+static float PackedRowHeuristic[65536];             // lineHeuristic() of every packed row
+
+
+//-------------------------------------------------------------------------------------
+// Heuristic value of one row or column, given the exponents of its tiles (0 for an
+// empty square), in order along the line
+double lineHeuristic(const int exponents[], int length)
+{
+	double sum = 0;
+	int empty = 0;
+	int merges = 0;
+	int previous = 0;
+	int counter = 0;    // Length of the current run of equal tiles, minus one
+	for (int i = 0; i < length; i++)
+	{
+		int exponent = exponents[i];
+		sum += SumTable[exponent];
+		if (exponent == 0)
+		{
+			empty++;
+		}
+		else
+		{
+			if (previous == exponent)
+			{
+				counter++;
+			}
+			else if (counter > 0)
+			{
+				merges += 1 + counter;
+				counter = 0;
+			}
+			previous = exponent;
+		}
+	}
+	if (counter > 0)
+	{
+		merges += 1 + counter;
+	}
+
+	double monotonicityLeft = 0;
+	double monotonicityRight = 0;
+	for (int i = 1; i < length; i++)
+	{
+		if (exponents[i - 1] > exponents[i])
+		{
+			monotonicityLeft += MonotonicityTable[exponents[i - 1]] - MonotonicityTable[exponents[i]];
+		}
+		else
+		{
+			monotonicityRight += MonotonicityTable[exponents[i]] - MonotonicityTable[exponents[i - 1]];
+		}
+	}
+
+	return LostPenalty + EmptyWeight * empty + MergesWeight * merges
+		- MonotonicityWeight * std::min(monotonicityLeft, monotonicityRight)
+		- SumWeight * sum;
+}
+
+//-------------------------------------------------------------------------------------
+static void buildHeuristicTables()
+{
+	for (int exponent = 0; exponent <= MaxExponent; exponent++)
+	{
+		MonotonicityTable[exponent] = std::pow((double)exponent, MonotonicityPower);
+		SumTable[exponent] = std::pow((double)exponent, SumPower);
+	}
+	for (int row = 0; row < 65536; row++)
+	{
+		int exponents[BitboardSide];
+		for (int i = 0; i < BitboardSide; i++)
+		{
+			exponents[i] = (row >> (4 * i)) & 0xF;
+		}
+		PackedRowHeuristic[row] = (float)lineHeuristic(exponents, BitboardSide);
+	}
+}
+
+//-------------------------------------------------------------------------------------
+static void initializeHeuristicTables()
+{
+	static std::once_flag tablesBuilt;
+	std::call_once(tablesBuilt, buildHeuristicTables);
+}
+
+//-------------------------------------------------------------------------------------
+// Exponent of a tile: 0 for an empty square, 1 for a 2, 2 for a 4, ...  Values that
+// are not powers of two (placed with 'p') are rounded down.
+static int tileExponent(int value)
+{
+	int exponent = 0;
+	while (value > 1)
+	{
+		value >>= 1;
+		exponent++;
+	}
+	return exponent;
+}
+
+//-------------------------------------------------------------------------------------
+// SplitMix64 finalizer, to spread packed boards over the table and to fold values
+// into a fingerprint
+static uint64_t mixKey(uint64_t z)
+{
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+//-------------------------------------------------------------------------------------
+TranspositionTable::TranspositionTable(int log2Buckets)
+	: storage(((size_t)2 * BucketEntries << log2Buckets) + CacheLineWords)
+{
+	uintptr_t address = (uintptr_t)storage.data();
+	words = storage.data() + (CacheLineWords - address / sizeof(uint64_t) % CacheLineWords) % CacheLineWords;
+	mask = ((uint64_t)1 << log2Buckets) - 1;
+	clear();
+}
+
+//-------------------------------------------------------------------------------------
+// Empty every entry and start the generations again, so the table searches exactly
+// as a new one would
+void TranspositionTable::clear()
+{
+	for (size_t i = 0; i < storage.size(); i++)
+	{
+		storage[i].store(0, std::memory_order_relaxed);
+	}
+	generation.store(1, std::memory_order_relaxed);
+}
+
+//-------------------------------------------------------------------------------------
+uint64_t TranspositionTable::packEntry(double value, int depth, int generation, int bestMove, int level)
+{
+	float stored = (float)value;
+	uint32_t bits;
+	memcpy(&bits, &stored, sizeof(bits));
+	return bits | (uint64_t)std::min(depth, 0xFF) << 32 | (uint64_t)(generation & 0xFF) << 40
+		| (uint64_t)(bestMove & 0xFF) << 48 | (uint64_t)level << 56;
+}
+
+//-------------------------------------------------------------------------------------
+// How unlikely a search was to reach a position: 0 for the root, and one more for
+// every halving of the probability
+int TranspositionTable::probabilityLevel(double probability)
+{
+	return std::min(-std::ilogb(probability), 0xFF);
+}
+
+//-------------------------------------------------------------------------------------
+// Value of the position with the given key, if it was stored by any search after
+// being searched at least depth chance layers deep and reached at least about as
+// likely, and the best move stored with it
+bool TranspositionTable::lookup(uint64_t key, int depth, double probability, double &value,
+	int &bestMove) const
+{
+	const std::atomic<uint64_t> *bucket = words + 2 * BucketEntries * (key & mask);
+	for (int e = 0; e < BucketEntries; e++)
+	{
+		uint64_t data = bucket[2 * e + 1].load(std::memory_order_relaxed);
+		if (data != 0 && (bucket[2 * e].load(std::memory_order_relaxed) ^ data) == key)
+		{
+			if ((int)((data >> 32) & 0xFF) < depth || (int)(data >> 56) > probabilityLevel(probability))
+			{
+				return false;
+			}
+			uint32_t bits = (uint32_t)data;
+			float stored;
+			memcpy(&stored, &bits, sizeof(stored));
+			value = stored;
+			bestMove = (int)((data >> 48) & 0xFF);
+			return true;
+		}
+	}
+	return false;
+}
+
+//-------------------------------------------------------------------------------------
+// Store a position's value, unless the bucket holds it already from a search at
+// least as deep that reached it at least as likely
+void TranspositionTable::store(uint64_t key, int depth, double probability, double value, int bestMove)
+{
+	std::atomic<uint64_t> *bucket = words + 2 * BucketEntries * (key & mask);
+	int current = (int)generation.load(std::memory_order_relaxed);
+	int level = probabilityLevel(probability);
+	int victim = 0;
+	int victimWorth = INT_MAX;
+	for (int e = 0; e < BucketEntries; e++)
+	{
+		uint64_t data = bucket[2 * e + 1].load(std::memory_order_relaxed);
+		int storedDepth = (int)((data >> 32) & 0xFF);
+		if (data != 0 && (bucket[2 * e].load(std::memory_order_relaxed) ^ data) == key)
+		{
+			if (storedDepth >= depth && (int)(data >> 56) <= level)
+			{
+				return;
+			}
+			victim = e;
+			break;
+		}
+		int age = (current - (int)(data >> 40)) & 0xFF;
+		int worth = (data == 0) ? INT_MIN : storedDepth - AgeWeight * age;
+		if (worth < victimWorth)
+		{
+			victim = e;
+			victimWorth = worth;
+		}
+	}
+	uint64_t data = packEntry(value, depth, current, bestMove, level);
+	bucket[2 * victim + 1].store(data, std::memory_order_relaxed);
+	bucket[2 * victim].store(key ^ data, std::memory_order_relaxed);
+}
+
+
+//-------------------------------------------------------------------------------------
+// Position on a packed 4x4 board
+struct PackedPosition
+{
+	Bitboard board;
+
+	// The positions after each of the four moves, whether each changed the board,
+	// and the points each scored
+	void moveAll(PackedPosition results[], bool changed[], int gains[]) const
+	{
+		Bitboard boards[NumberOfDirections];
+		bitboardSlideAll(board, boards, gains);
+		for (int d = 0; d < NumberOfDirections; d++)
+		{
+			results[d].board = boards[d];
+			changed[d] = (boards[d] != board);
+		}
+	}
+
+	// Fill in the indexes of the empty squares and return how many there are
+	int emptySquares(int squares[]) const
+	{
+		int count = 0;
+		for (uint64_t mask = emptySquaresMask(board); mask != 0; mask &= mask - 1)
+		{
+			squares[count++] = lowestSetNibble(mask);
+		}
+		return count;
+	}
+
+	PackedPosition withTile(int square, int exponent) const
+	{
+		PackedPosition result = { board | ((Bitboard)exponent << (4 * square)) };
+		return result;
+	}
+
+	// Keys of the root, the same for every symmetry, and of a position inside the
+	// tree, where symmetric transpositions are too rare to be worth hashing all 8
+	CanonicalHash hash() const { return canonicalHash(board); }
+	uint64_t key() const { return mixKey(board); }
+
+	double evaluate(const NTupleNetwork *network) const
+	{
+		if (network != NULL)
+		{
+			return network->evaluate(board);
+		}
+		Bitboard columns = transposeBitboard(board);
+		double value = 0;
+		for (int i = 0; i < BitboardSide; i++)
+		{
+			value += PackedRowHeuristic[(board >> (16 * i)) & 0xFFFF];
+			value += PackedRowHeuristic[(columns >> (16 * i)) & 0xFFFF];
+		}
+		return value;
+	}
+};
+
+//-------------------------------------------------------------------------------------
+// Position on an N x N int board, holding just the N*N squares in use
+template<int N>
+struct ArrayPosition
+{
+	int cells[N * N];
+
+	void moveAll(ArrayPosition results[], bool changed[], int gains[]) const
+	{
+		int *boards[NumberOfDirections] = {
+			results[DirectionLeft].cells, results[DirectionRight].cells,
+			results[DirectionUp].cells, results[DirectionDown].cells
+		};
+		slideAllKernel<N>(cells, boards, gains, changed);
+	}
+
+	int emptySquares(int squares[]) const
+	{
+		int count = 0;
+		for (int i = 0; i < N * N; i++)
+		{
+			if (cells[i] == 0)
+			{
+				squares[count++] = i;
+			}
+		}
+		return count;
+	}
+
+	ArrayPosition withTile(int square, int exponent) const
+	{
+		ArrayPosition result = *this;
+		result.cells[square] = 1 << exponent;
+		return result;
+	}
+
+	// The same key for the root and inside the tree: hashing is cheap next to
+	// moving an int board
+	CanonicalHash hash() const { return canonicalHash(cells, N); }
+	uint64_t key() const { return canonicalHash(cells, N).hash; }
+
+	// Networks are only for packed boards
+	double evaluate(const NTupleNetwork *) const
+	{
+		double value = 0;
+		int rowExponents[N];
+		int columnExponents[N];
+		for (int line = 0; line < N; line++)
+		{
+			for (int i = 0; i < N; i++)
+			{
+				rowExponents[i] = tileExponent(cells[line * N + i]);
+				columnExponents[i] = tileExponent(cells[i * N + line]);
+			}
+			value += lineHeuristic(rowExponents, N) + lineHeuristic(columnExponents, N);
+		}
+		return value;
+	}
+};
+
+
+//-------------------------------------------------------------------------------------
+// The search itself, for either kind of position
+template<class Position>
+class Expectimax
+{
+public:
+	Expectimax(TranspositionTable &table, const ExpectimaxConfig &config)
+		: table(table), config(config), nodes(0)
+	{
+		salt = (config.network != NULL) ? config.network->getFingerprint() : 0;
+	}
+
+	ExpectimaxResult search(const Position &root, int depth)
+	{
+		ExpectimaxResult result;
+		result.found = false;
+		result.bestMove = DirectionLeft;
+		result.value = 0;
+		result.depth = depth;
+
+		table.newSearch();
+
+		// A position searched before, or one of its symmetries, at least this deep
+		CanonicalHash hash = root.hash();
+		hash.hash ^= salt;
+		double storedValue;
+		int storedMove;
+		if (table.lookup(hash.hash ^ RootKey, depth, 1.0, storedValue, storedMove) && storedMove < NumberOfDirections)
+		{
+			return storedResult(result, hash, storedValue, storedMove);
+		}
+		if (config.cache != NULL && config.cache->lookup(hash.hash, depth, storedValue, storedMove)
+			&& storedMove < NumberOfDirections)
+		{
+			table.store(hash.hash ^ RootKey, depth, 1.0, storedValue, storedMove);
+			return storedResult(result, hash, storedValue, storedMove);
+		}
+
+		Position next[NumberOfDirections];
+		bool changed[NumberOfDirections];
+		int gains[NumberOfDirections];
+		root.moveAll(next, changed, gains);
+		for (int d = 0; d < NumberOfDirections; d++)
+		{
+			if (changed[d])
+			{
+				double value = moveGain(gains[d]) + chanceNode(next[d], depth, 1.0);
+				if (!result.found || value > result.value)
+				{
+					result.found = true;
+					result.bestMove = (Direction)d;
+					result.value = value;
+				}
+			}
+		}
+		if (result.found)
+		{
+			int move = symmetricDirection(hash.symmetry, result.bestMove);
+			table.store(hash.hash ^ RootKey, depth, 1.0, result.value, move);
+			if (config.cache != NULL)
+			{
+				config.cache->store(hash.hash, depth, result.value, move);
+			}
+		}
+		result.nodes = nodes;
+		return result;
+	}
+
+private:
+	// Fill in the result from a stored value and best move, the move being for the
+	// board seen through the hash's symmetry
+	ExpectimaxResult &storedResult(ExpectimaxResult &result, const CanonicalHash &hash,
+		double value, int move)
+	{
+		result.found = true;
+		result.bestMove = originalDirection(hash.symmetry, (Direction)move);
+		result.value = value;
+		result.nodes = 0;
+		return result;
+	}
+
+	// Points a move makes, counted only when the network evaluates positions: its
+	// values are the points still to come, while the heuristic's are of the board
+	double moveGain(int gain) const
+	{
+		return (config.network != NULL) ? gain : 0;
+	}
+
+	// Best value over the four directions, or 0 if the game is lost
+	double maxNode(const Position &position, int depth, double probability)
+	{
+		double best = 0;
+		Position next[NumberOfDirections];
+		bool changed[NumberOfDirections];
+		int gains[NumberOfDirections];
+		position.moveAll(next, changed, gains);
+		for (int d = 0; d < NumberOfDirections; d++)
+		{
+			if (changed[d])
+			{
+				best = std::max(best, moveGain(gains[d]) + chanceNode(next[d], depth, probability));
+			}
+		}
+		return best;
+	}
+
+	// Average value over every possible new piece
+	double chanceNode(const Position &position, int depth, double probability)
+	{
+		if (depth <= 0 || probability < config.minProbability)
+		{
+			return position.evaluate(config.network);
+		}
+
+		uint64_t key = position.key() ^ salt;
+		double value;
+		int move;
+		if (table.lookup(key, depth, probability, value, move))
+		{
+			return value;
+		}
+
+		nodes++;
+		int squares[MaxBoardSize * MaxBoardSize];
+		int count = position.emptySquares(squares);
+		double childProbability = probability / (2 * count);
+		value = 0;
+		for (int i = 0; i < count; i++)
+		{
+			// A 2 and a 4 are equally likely, see placeRandomPiece()
+			value += maxNode(position.withTile(squares[i], 1), depth - 1, childProbability);
+			value += maxNode(position.withTile(squares[i], 2), depth - 1, childProbability);
+		}
+		value /= 2 * count;
+
+		table.store(key, depth, probability, value);
+		return value;
+	}
+
+	TranspositionTable &table;
+	const ExpectimaxConfig &config;
+	uint64_t salt;      // XORed into every key, so each evaluation has its own entries
+	int64_t nodes;
+};
+
+
+//-------------------------------------------------------------------------------------
+// Chance layers to search.  Every chance node has two children per empty square, so
+// the search can afford to go deeper when the board is nearly full.
+static int chooseDepth(int squaresPerSide, int emptyCount, const ExpectimaxConfig &config)
+{
+	if (config.maxDepth > 0)
+	{
+		return config.maxDepth;
+	}
+	if (squaresPerSide == BitboardSide)
+	{
+		return (emptyCount >= 8) ? 2 : (emptyCount >= 4) ? 3 : 4;
+	}
+	return (emptyCount >= 16) ? 1 : 2;
+}
+
+//-------------------------------------------------------------------------------------
+// Copy the game's board into an ArrayPosition<N> and search it
+template<int N>
+static ExpectimaxResult searchArray(const Game &game, TranspositionTable &table,
+	const ExpectimaxConfig &config, int depth)
+{
+	ArrayPosition<N> root;
+	copyBoard(game.board, root.cells, N);
+	Expectimax<ArrayPosition<N> > search(table, config);
+	return search.search(root, depth);
+}
+
+//-------------------------------------------------------------------------------------
+// Search the game's position for the direction with the best expected value
+ExpectimaxResult searchBestMove(const Game &game, const ExpectimaxConfig &config)
+{
+	initializeBitboardTables();
+	initializeHeuristicTables();
+
+	initializeZobristTables();
+
+	// Unless the config has a table, one for every thread, so each search can use
+	// what the others found
+	TranspositionTable *searchTable = config.table;
+	if (searchTable == NULL)
+	{
+		static TranspositionTable sharedTable;
+		searchTable = &sharedTable;
+	}
+	TranspositionTable &table = *searchTable;
+
+	int depth = chooseDepth(game.squaresPerSide, game.emptyCells.count(), config);
+	PackedPosition packed;
+	if (game.squaresPerSide == BitboardSide && packBoard(game.board, packed.board))
+	{
+		Expectimax<PackedPosition> search(table, config);
+		return search.search(packed, depth);
+	}
+
+	// Boards that do not pack are evaluated by the heuristic, network or not
+	ExpectimaxConfig arrayConfig = config;
+	arrayConfig.network = NULL;
+	switch (game.squaresPerSide) {
+	case 4:  return searchArray<4>(game, table, arrayConfig, depth);
+	case 5:  return searchArray<5>(game, table, arrayConfig, depth);
+	case 6:  return searchArray<6>(game, table, arrayConfig, depth);
+	case 7:  return searchArray<7>(game, table, arrayConfig, depth);
+	case 8:  return searchArray<8>(game, table, arrayConfig, depth);
+	case 9:  return searchArray<9>(game, table, arrayConfig, depth);
+	case 10: return searchArray<10>(game, table, arrayConfig, depth);
+	case 11: return searchArray<11>(game, table, arrayConfig, depth);
+	default: return searchArray<12>(game, table, arrayConfig, depth);
+	}
+}
+
+//-------------------------------------------------------------------------------------
+// Fingerprint of what the search's values mean, for an EvaluationCache file: the
+// heuristic's value on a fixed set of lines, the network's weights if there is one,
+// the probability below which chance paths are cut off, and the keys positions get.
+// Results saved under one fingerprint are not used by a search with another.
+uint64_t expectimaxFingerprint(const ExpectimaxConfig &config)
+{
+	initializeBitboardTables();
+	initializeHeuristicTables();
+	initializeZobristTables();
+
+	uint64_t fingerprint;
+	memcpy(&fingerprint, &config.minProbability, sizeof(fingerprint));
+	GameRng rng(FingerprintSeed, 0);
+	for (int length = MinBoardSize; length <= MaxBoardSize; length++)
+	{
+		for (int line = 0; line < FingerprintLines; line++)
+		{
+			int exponents[MaxBoardSize];
+			for (int i = 0; i < length; i++)
+			{
+				exponents[i] = (rng.nextBelow(3) == 0) ? 0 : 1 + rng.nextBelow(15);   // Tiles from 2 to 32768
+			}
+			double value = lineHeuristic(exponents, length);
+			uint64_t bits;
+			memcpy(&bits, &value, sizeof(bits));
+			fingerprint = mixKey(fingerprint ^ bits);
+		}
+	}
+
+	if (config.network != NULL)
+	{
+		fingerprint = mixKey(fingerprint ^ config.network->getFingerprint());
+	}
+
+	// A board that packs, hashed both ways
+	int board[BitboardSide * BitboardSide];
+	for (int i = 0; i < BitboardSide * BitboardSide; i++)
+	{
+		board[i] = (i % 3 == 0) ? 0 : 2 << (i % 7);
+	}
+	Bitboard packed = 0;
+	packBoard(board, packed);
+	fingerprint = mixKey(fingerprint ^ canonicalHash(board, BitboardSide).hash);
+	return mixKey(fingerprint ^ canonicalHash(packed).hash);
+}
@@ -0,0 +1,111 @@
+//  expectimax.h
+//     Expectimax search over the game tree, used for the in-game hint and as a move
+//     policy for the batch mode.
+//
+//     Max nodes try the four slide directions; chance nodes average over every empty
+//     square receiving a 2 or a 4, each equally likely, just as placeRandomPiece()
+//     does.  Positions already searched to at least the same depth, by this search or
+//     an earlier one, are looked up in a transposition table: the config's own, or
+//     else one shared by every thread, so each search can use what the others found.
+//     Searches sharing a table can get different results depending on what else was
+//     searched first, so the batch mode gives each game a table of its own.  Roots,
+//     and every position of a board bigger than 4x4, are keyed by canonicalHash(), so
+//     a position and its rotations and reflections are searched only once; packed
+//     positions inside the tree are keyed by their bits alone, which is much cheaper
+//     and misses few transpositions.  The best move at the root is kept too, turned to
+//     match the symmetry the hash came from, so a repeated root costs a single lookup.
+//     With a cache in the config, root results are also looked up in and saved to its
+//     file, so they outlast the process.
+//
+//     With a network in the config, packed 4x4 positions are evaluated by it instead
+//     of the line heuristic.  The network values a board by the points still to come,
+//     so the search then adds the points each move makes, and its positions are keyed
+//     apart from the heuristic's in the shared table.
+//
+//     Unless a depth is given, the search goes deeper when there are few empty
+//     squares, since then each chance node has fewer children.
+//
+//     The search works on compact copies of the board: a packed Bitboard for 4x4
+//     boards, and otherwise an array of exactly squaresPerSide*squaresPerSide ints moved
+//     with the size-specialized kernels of boardkernels.h.
+
+#ifndef EXPECTIMAX_H
+#define EXPECTIMAX_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <atomic>
+#include "game.h"
+
+class EvaluationCache;
+class NTupleNetwork;
+class TranspositionTable;
+
+struct ExpectimaxConfig
+{
+	int maxDepth;            // Chance layers to search; 0 picks one from the number of empty squares
+	double minProbability;   // Chance paths less likely than this are evaluated instead of expanded
+	EvaluationCache *cache;  // File of earlier searches' results, or NULL; see evalcache.h
+	const NTupleNetwork *network;   // Learned evaluation for packed boards, or NULL; see ntuple.h
+	TranspositionTable *table;      // Table to search with, or NULL for the one every thread shares
+
+	ExpectimaxConfig() { maxDepth = 0; minProbability = 0.0001; cache = NULL; network = NULL; table = NULL; }
+};
+
+struct ExpectimaxResult
+{
+	bool found;              // False if no direction changes the board
+	Direction bestMove;
+	double value;            // Expected value of bestMove, by the heuristic or the network
+	int depth;               // Chance layers searched
+	int64_t nodes;           // Positions expanded
+};
+
+//-------------------------------------------------------------------------------------
+// Fixed-size table of position values, which any number of threads can search with
+// at once, without locks.  A key picks a bucket of BucketEntries entries filling one
+// cache line, and the position may be in any entry of it; a new position replaces
+// the entry searched least deep, counting entries from older searches as shallower.
+//
+// How closely a position is searched depends on how likely the search was to reach
+// it, since less likely paths below it are evaluated rather than expanded.  So an
+// entry is only used by searches that reach its position at most about as likely
+// (within a factor of 2) as the one that stored it, and searched no deeper.
+//
+// Each entry is two 64-bit words, each read and written atomically: the entry's
+// data, and its key XORed with the data.  An entry that two threads wrote at once
+// can hold one thread's data and the other's check word, but then its key does not
+// come out right and the entry is simply missed.
+class TranspositionTable
+{
+public:
+	static const int BucketEntries = 4;
+	static const int NoMove = 0xFF;    // Stored in place of a best move for chance nodes
+	static const int DefaultLog2Buckets = 16;   // 2^16 buckets of 64 bytes, 4 MB
+
+	explicit TranspositionTable(int log2Buckets = DefaultLog2Buckets);
+
+	void clear();   // Forget every entry; not to be called while any search uses the table
+	void newSearch() { generation.fetch_add(1, std::memory_order_relaxed); }
+	bool lookup(uint64_t key, int depth, double probability, double &value, int &bestMove) const;
+	void store(uint64_t key, int depth, double probability, double value, int bestMove = NoMove);
+
+private:
+	// Entry data: the value's float bits, then the depth, the generation of the
+	// search that stored it, the best move and the probability level, a byte each.
+	// 0 for an unused entry.
+	static uint64_t packEntry(double value, int depth, int generation, int bestMove, int level);
+	static int probabilityLevel(double probability);
+
+	std::vector<std::atomic<uint64_t> > storage;   // Holds the entries, with room to align them
+	std::atomic<uint64_t> *words;    // Entry e of bucket b at words[2 * (b * BucketEntries + e)]
+	uint64_t mask;                   // Buckets - 1
+	std::atomic<unsigned> generation;
+};
+
+ExpectimaxResult searchBestMove(const Game &game, const ExpectimaxConfig &config = ExpectimaxConfig());
+uint64_t expectimaxFingerprint(const ExpectimaxConfig &config);
+double lineHeuristic(const int exponents[], int length);
+
+#endif // EXPECTIMAX_H
@@ -0,0 +1,433 @@
+//  fuzz.cpp
+//     Differential fuzzer for the move kernels.  This is a program of its own, built
+//     from the engine's files in place of main.cpp.
+//
+//     It makes random boards of every size, from nearly empty to full, mostly of
+//     small powers of two so that tiles merge often, with now and then a tile too
+//     large for the packed 4x4 boards or a value no move could make (as the 'p'
+//     command can place).  Every board is moved in every direction by each of the
+//     faster kernels and by the reference slides in board.cpp, and the boards, the
+//     points scored and whether the board changed must all agree:
+//
+//        slideBoard       the size-specialized and packed kernels the game uses,
+//                         with the open squares and largest tile they keep up to date
+//        traced           the same kernels leaving a trace of every tile for the window
+//        slideAll         all four moves in one pass
+//        hasLegalMove     whether any move changes the board
+//        bitboard         the packed 4x4 kernels, on boards that pack
+//        lockstep         the vector engine, whose boards must also gain one 2 or 4
+//        bigboard         the any-size board with 64-bit tiles
+//
+//     Each round also plays one seeded game through both makeMove() overloads, the
+//     untraced one the batch mode and the servers use and the traced one the window
+//     uses, and the two games must place the same pieces and stay the same:
+//
+//        tracedGame       the traced and untraced games, move by move
+//
+//     Run with:
+//        fuzz [--boards N] [--seed X]
+//     It prints one line per kernel and the first board each one got wrong, and
+//     exits with 1 if any kernel disagreed with the reference.
+
+#include "board.h"
+#include "boardkernels.h"
+#include "bitboard.h"
+#include "emptycells.h"
+#include "gamerng.h"
+#include "batchengine.h"
+#include "bigboard.h"
+#include "game.h"
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+
+const int BoardsPerRound = 64;   // Boards made at a time, and games in each lockstep engine
+const int MaxGameMoves = 5000;   // Moves tried in each game played both ways
+
+// Checks made with one kernel, and how many of them failed
+struct KernelTally
+{
+	const char *name;
+	int64_t checked;
+	int64_t mismatches;
+};
+
+enum Kernel { KernelSlideBoard, KernelTraced, KernelSlideAll, KernelHasLegalMove,
+	KernelBitboard, KernelLockstep, KernelBigBoard, KernelTracedGame, NumberOfKernels };
+
+static KernelTally tallies[NumberOfKernels] = {
+	{ "slideBoard", 0, 0 }, { "traced", 0, 0 }, { "slideAll", 0, 0 },
+	{ "hasLegalMove", 0, 0 }, { "bitboard", 0, 0 }, { "lockstep", 0, 0 }, { "bigboard", 0, 0 },
+	{ "tracedGame", 0, 0 }
+};
+
+// The result of one reference move
+struct ReferenceMove
+{
+	int board[MaxBoardSize * MaxBoardSize];
+	int gain;
+	bool changed;
+};
+
+
+//-------------------------------------------------------------------------------------
+// Fill the board with random tiles at a random density
+static void makeRandomBoard(GameRng &rng, int board[], int squaresPerSide)
+{
+	uint32_t density = rng.nextBelow(101);   // Percent of the squares with a tile
+	for (int i = 0; i < squaresPerSide * squaresPerSide; i++)
+	{
+		board[i] = 0;
+		if (rng.nextBelow(100) >= density)
+		{
+			continue;
+		}
+		uint32_t kind = rng.nextBelow(1000);
+		if (kind < 950)
+		{
+			board[i] = 2 << rng.nextBelow(4);     // 2 to 16, so neighbors often match
+		}
+		else if (kind < 995)
+		{
+			board[i] = 2 << rng.nextBelow(20);    // Up to 2^20, past what a nibble holds
+		}
+		else
+		{
+			board[i] = 1 + rng.nextBelow(100);    // Any value at all
+		}
+	}
+}
+
+//-------------------------------------------------------------------------------------
+// Move a copy of the board with the reference slides of board.cpp
+static void referenceMove(const int board[], int squaresPerSide, Direction direction, ReferenceMove &move)
+{
+	copyBoard(board, move.board, squaresPerSide);
+	move.gain = 0;
+	switch (direction) {
+	case DirectionLeft:  slideLeft(move.board, squaresPerSide, move.gain);  break;
+	case DirectionRight: slideRight(move.board, squaresPerSide, move.gain); break;
+	case DirectionUp:    slideUp(move.board, squaresPerSide, move.gain);    break;
+	case DirectionDown:  slideDown(move.board, squaresPerSide, move.gain);  break;
+	}
+	move.changed = (memcmp(board, move.board, squaresPerSide * squaresPerSide * sizeof(int)) != 0);
+}
+
+//-------------------------------------------------------------------------------------
+static bool sameBoard(const int a[], const int b[], int squaresPerSide)
+{
+	return memcmp(a, b, squaresPerSide * squaresPerSide * sizeof(int)) == 0;
+}
+
+//-------------------------------------------------------------------------------------
+static int largestTile(const int board[], int squaresPerSide)
+{
+	int largest = 0;
+	for (int i = 0; i < squaresPerSide * squaresPerSide; i++)
+	{
+		largest = std::max(largest, board[i]);
+	}
+	return largest;
+}
+
+//-------------------------------------------------------------------------------------
+// Count one check of a kernel, and show the board if it is the kernel's first failure
+static void tally(Kernel kernel, bool agrees, const int board[], int squaresPerSide, Direction direction)
+{
+	KernelTally &kernelTally = tallies[kernel];
+	kernelTally.checked++;
+	if (agrees)
+	{
+		return;
+	}
+	if (kernelTally.mismatches++ == 0)
+	{
+		static const char *DirectionNames[NumberOfDirections] = { "left", "right", "up", "down" };
+		std::cout << kernelTally.name << " disagrees moving " << DirectionNames[direction]
+			<< " from the " << squaresPerSide << "x" << squaresPerSide << " board:\n";
+		for (int row = 0; row < squaresPerSide; row++)
+		{
+			for (int col = 0; col < squaresPerSide; col++)
+			{
+				std::cout << std::setw(8) << board[row * squaresPerSide + col];
+			}
+			std::cout << "\n";
+		}
+	}
+}
+
+//-------------------------------------------------------------------------------------
+// The open squares must be exactly the board's empty squares
+static bool emptyCellsMatch(const EmptyCells &emptyCells, const int board[], int squaresPerSide)
+{
+	int empty = 0;
+	for (int i = 0; i < squaresPerSide * squaresPerSide; i++)
+	{
+		empty += (board[i] == 0);
+	}
+	if (emptyCells.count() != empty)
+	{
+		return false;
+	}
+	for (int k = 0; k < emptyCells.count(); k++)
+	{
+		if (board[emptyCells.cell(k)] != 0)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+//-------------------------------------------------------------------------------------
+// Every tile of the old board must appear in the trace once, as the value that ended
+// up where it went, or half of it if it merged there
+static bool traceMatches(const MoveTrace &trace, const int before[], const int after[], int squaresPerSide)
+{
+	int tiles = 0;
+	for (int i = 0; i < squaresPerSide * squaresPerSide; i++)
+	{
+		tiles += (before[i] != 0);
+	}
+	if (trace.count != tiles)
+	{
+		return false;
+	}
+	bool seen[MaxBoardSize * MaxBoardSize] = { false };
+	for (int k = 0; k < trace.count; k++)
+	{
+		const TileMove &tile = trace.moves[k];
+		int value = tile.merged ? after[tile.to] / 2 : after[tile.to];
+		if (seen[tile.from] || before[tile.from] != value)
+		{
+			return false;
+		}
+		seen[tile.from] = true;
+	}
+	return true;
+}
+
+//-------------------------------------------------------------------------------------
+// Check every kernel that moves one board at a time
+static void checkBoard(const int board[], int squaresPerSide)
+{
+	int squares = squaresPerSide * squaresPerSide;
+	ReferenceMove reference[NumberOfDirections];
+	bool anyChanged = false;
+	for (int d = 0; d < NumberOfDirections; d++)
+	{
+		referenceMove(board, squaresPerSide, (Direction)d, reference[d]);
+		anyChanged |= reference[d].changed;
+	}
+
+	AllMoves all;
+	slideAllDirections(board, squaresPerSide, all);
+	Bitboard packed;
+	bool packs = (squaresPerSide == BitboardSide && packBoard(board, packed));
+	BigBoard big(squaresPerSide, 0, 0);
+
+	for (int d = 0; d < NumberOfDirections; d++)
+	{
+		Direction direction = (Direction)d;
+		const ReferenceMove &expected = reference[d];
+		int moved[MaxBoardSize * MaxBoardSize];
+
+		// The game's kernels, with the state they keep up to date
+		copyBoard(board, moved, squaresPerSide);
+		EmptyCells emptyCells;
+		emptyCells.reset(moved, squaresPerSide);
+		int score = 0;
+		int maxTile = largestTile(board, squaresPerSide);
+		bool changed = slideBoard(moved, squaresPerSide, direction, score, &emptyCells, &maxTile);
+		tally(KernelSlideBoard, sameBoard(moved, expected.board, squaresPerSide)
+			&& score == expected.gain && changed == expected.changed
+			&& emptyCellsMatch(emptyCells, moved, squaresPerSide)
+			&& maxTile == largestTile(expected.board, squaresPerSide),
+			board, squaresPerSide, direction);
+
+		copyBoard(board, moved, squaresPerSide);
+		MoveTrace trace;
+		score = 0;
+		changed = slideBoard(moved, squaresPerSide, direction, score, trace);
+		tally(KernelTraced, sameBoard(moved, expected.board, squaresPerSide)
+			&& score == expected.gain && changed == expected.changed
+			&& traceMatches(trace, board, moved, squaresPerSide),
+			board, squaresPerSide, direction);
+
+		tally(KernelSlideAll, sameBoard(all.boards[d], expected.board, squaresPerSide)
+			&& all.gains[d] == expected.gain && all.changed[d] == expected.changed,
+			board, squaresPerSide, direction);
+
+		if (packs)
+		{
+			int gain = 0;
+			Bitboard result = packed;
+			switch (direction) {
+			case DirectionLeft:  result = bitboardSlideLeft(packed, gain);  break;
+			case DirectionRight: result = bitboardSlideRight(packed, gain); break;
+			case DirectionUp:    result = bitboardSlideUp(packed, gain);    break;
+			case DirectionDown:  result = bitboardSlideDown(packed, gain);  break;
+			}
+			unpackBoard(result, moved);
+			tally(KernelBitboard, sameBoard(moved, expected.board, squaresPerSide)
+				&& gain == expected.gain && (result != packed) == expected.changed,
+				board, squaresPerSide, direction);
+		}
+
+		for (int i = 0; i < squares; i++)
+		{
+			big.set(i / squaresPerSide, i % squaresPerSide, (uint64_t)board[i]);
+		}
+		uint64_t oldScore = big.getScore();
+		changed = big.slide(direction);
+		bool agrees = (changed == expected.changed && big.getScore() - oldScore == (uint64_t)expected.gain);
+		for (int i = 0; i < squares; i++)
+		{
+			agrees &= (big.get(i / squaresPerSide, i % squaresPerSide) == (uint64_t)expected.board[i]);
+		}
+		tally(KernelBigBoard, agrees, board, squaresPerSide, direction);
+	}
+
+	tally(KernelHasLegalMove, hasLegalMove(board, squaresPerSide) == anyChanged,
+		board, squaresPerSide, DirectionLeft);
+}
+
+//-------------------------------------------------------------------------------------
+// Make a move in a random direction on each board at once with the lockstep engine.
+// A game that did not move must be unchanged; one that did must match the reference
+// but for one new 2 or 4 on a square the reference left empty.
+static void checkLockstep(BatchEngine &engine, GameRng &rng, int boards[][MaxBoardSize * MaxBoardSize])
+{
+	int squaresPerSide = engine.getSquaresPerSide();
+	int squares = squaresPerSide * squaresPerSide;
+	uint8_t actions[BoardsPerRound], done[BoardsPerRound], moved[BoardsPerRound];
+	int32_t rewards[BoardsPerRound];
+	for (int g = 0; g < BoardsPerRound; g++)
+	{
+		engine.setBoard(g, boards[g]);
+		actions[g] = (uint8_t)rng.nextBelow(NumberOfDirections);
+	}
+	engine.step(actions, rewards, done, moved);
+
+	for (int g = 0; g < BoardsPerRound; g++)
+	{
+		ReferenceMove expected;
+		referenceMove(boards[g], squaresPerSide, (Direction)actions[g], expected);
+		int result[MaxBoardSize * MaxBoardSize];
+		engine.getBoard(g, result);
+		bool agrees = ((moved[g] != 0) == expected.changed && rewards[g] == expected.gain);
+		int placed = 0;
+		for (int i = 0; i < squares && agrees; i++)
+		{
+			if (result[i] == expected.board[i])
+			{
+				continue;
+			}
+			placed++;
+			agrees = (expected.changed && expected.board[i] == 0 && (result[i] == 2 || result[i] == 4));
+		}
+		agrees &= (placed == (expected.changed ? 1 : 0));
+		tally(KernelLockstep, agrees, boards[g], squaresPerSide, (Direction)actions[g]);
+	}
+}
+
+//-------------------------------------------------------------------------------------
+// Play game gameIndex of the seed twice with the same random moves, once with the
+// untraced makeMove() and once with the traced one, until neither can move.  The
+// games must agree after every move; the first board they differ on is reported.
+static void checkTracedGame(GameRng &rng, int squaresPerSide, uint64_t seed, uint64_t gameIndex)
+{
+	Game untraced, traced;
+	newGame(untraced, squaresPerSide, seed, gameIndex);
+	newGame(traced, squaresPerSide, seed, gameIndex);
+	bool agrees = sameBoard(untraced.board, traced.board, squaresPerSide);
+	Direction direction = DirectionLeft;
+	int before[MaxBoardSize * MaxBoardSize];
+	for (int move = 0; move < MaxGameMoves && agrees && hasLegalMove(untraced); move++)
+	{
+		direction = (Direction)rng.nextBelow(NumberOfDirections);
+		copyBoard(untraced.board, before, squaresPerSide);
+		MoveTrace trace;
+		bool moved = makeMove(untraced, direction);
+		agrees = (makeMove(traced, direction, trace) == moved
+			&& sameBoard(untraced.board, traced.board, squaresPerSide)
+			&& untraced.score == traced.score && untraced.maxTile == traced.maxTile
+			&& untraced.lastSpawnSquare == traced.lastSpawnSquare);
+	}
+	tally(KernelTracedGame, agrees, agrees ? untraced.board : before, squaresPerSide, direction);
+}
+
+//-------------------------------------------------------------------------------------
+static void displayUsage()
+{
+	std::cout << "Usage: fuzz [--boards N] [--seed X]\n";
+}
+
+//-------------------------------------------------------------------------------------
+int main(int argc, char *argv[])
+{
+	int64_t numberOfBoards = 100000;
+	uint64_t seed = 1;
+	for (int i = 1; i < argc; i++)
+	{
+		const char *option = argv[i];
+		const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+		if (value == NULL)
+		{
+			displayUsage();
+			return 1;
+		}
+		if (strcmp(option, "--boards") == 0) {
+			numberOfBoards = atoll(value);
+		}
+		else if (strcmp(option, "--seed") == 0) {
+			seed = strtoull(value, NULL, 10);
+		}
+		else {
+			displayUsage();
+			return 1;
+		}
+		i++;   // Skip over the value
+	}
+
+	initializeBitboardTables();
+	GameRng rng(seed, 0);
+
+	// One lockstep engine for each board size
+	std::vector<BatchEngine *> engines;
+	for (int size = MinBoardSize; size <= MaxBoardSize; size++)
+	{
+		engines.push_back(new BatchEngine(BoardsPerRound, size, seed));
+	}
+
+	static int boards[BoardsPerRound][MaxBoardSize * MaxBoardSize];
+	for (int64_t made = 0; made < numberOfBoards; made += BoardsPerRound)
+	{
+		int squaresPerSide = MinBoardSize + rng.nextBelow(MaxBoardSize - MinBoardSize + 1);
+		for (int g = 0; g < BoardsPerRound; g++)
+		{
+			makeRandomBoard(rng, boards[g], squaresPerSide);
+			checkBoard(boards[g], squaresPerSide);
+		}
+		checkLockstep(*engines[squaresPerSide - MinBoardSize], rng, boards);
+		checkTracedGame(rng, squaresPerSide, seed, (uint64_t)made);
+	}
+	for (size_t e = 0; e < engines.size(); e++)
+	{
+		delete engines[e];
+	}
+
+	int64_t mismatches = 0;
+	std::cout << "instruction_set: " << BatchEngine::instructionSet() << "\n";
+	for (int k = 0; k < NumberOfKernels; k++)
+	{
+		std::cout << tallies[k].name << ": checked " << tallies[k].checked
+			<< ", mismatches " << tallies[k].mismatches << "\n";
+		mismatches += tallies[k].mismatches;
+	}
+	std::cout << "total_mismatches: " << mismatches << "\n";
+	return mismatches == 0 ? 0 : 1;
+}
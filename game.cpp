@@ -0,0 +1,151 @@
+//  game.cpp
+//     Headless game engine.  See game.h.
+
+#include "game.h"
+#include "boardkernels.h"
+#include "metrics.h"
+
+const int MaxTileStartValue = 1024;   // Max tile value to start out on a 4x4 board
+
+
+//-------------------------------------------------------------------------------------
+// Largest tile on the board, found by looking at every square
+static int largestTile(const int board[], int squaresPerSide)
+{
+	int largest = 0;
+	for (int i = 0; i < squaresPerSide * squaresPerSide; i++)
+	{
+		if (board[i] > largest)
+		{
+			largest = board[i];
+		}
+	}
+	return largest;
+}
+
+//-------------------------------------------------------------------------------------
+// Start a new game on an empty board with two random pieces.  The pieces placed
+// during the game come from the stream for game gameIndex of the given seed, so the
+// same seed, index and moves always give the same game.
+void newGame(Game &game, int squaresPerSide, uint64_t seed, uint64_t gameIndex)
+{
+	game.squaresPerSide = squaresPerSide;
+	game.score = 0;
+	game.moveNumber = 1;
+	game.rng.reseed(seed, gameIndex);
+	initializeBoard(game.board, squaresPerSide, 0);
+	game.emptyCells.reset(game.board, squaresPerSide);
+	placeRandomPiece(game.board, game.emptyCells, game.rng);
+	game.lastSpawnSquare = placeRandomPiece(game.board, game.emptyCells, game.rng);
+	game.maxTile = largestTile(game.board, squaresPerSide);
+}
+
+//-------------------------------------------------------------------------------------
+// Place a new random piece after the pieces have slid, and count the move
+static void finishMove(Game &game)
+{
+	METRICS_START(spawnTimer, TimerSpawn);
+	game.lastSpawnSquare = placeRandomPiece(game.board, game.emptyCells, game.rng);
+	METRICS_STOP(spawnTimer);
+	METRICS_COUNT(CounterMoves, 1);
+	if (game.lastSpawnSquare >= 0 && game.board[game.lastSpawnSquare] > game.maxTile)
+	{
+		game.maxTile = game.board[game.lastSpawnSquare];
+	}
+	game.moveNumber++;
+}
+
+//-------------------------------------------------------------------------------------
+// Slide the pieces in the given direction.  If that changed the board, place a new
+// random piece and count the move.  Returns false, leaving the game unchanged, if
+// the move did not change the board.  The open squares and the largest tile are
+// updated as the pieces move, never by looking over the whole board.
+bool makeMove(Game &game, Direction direction)
+{
+	METRICS_ONLY(int emptyBefore = game.emptyCells.count());
+	METRICS_START(kernelTimer, TimerMoveKernel);
+	bool moved = slideBoard(game.board, game.squaresPerSide, direction, game.score,
+		&game.emptyCells, &game.maxTile);
+	METRICS_STOP(kernelTimer);
+	if (!moved)
+	{
+		METRICS_COUNT(CounterRejectedMoves, 1);
+		return false;
+	}
+	METRICS_COUNT(CounterMerges, game.emptyCells.count() - emptyBefore);   // Each merge opens a square
+	finishMove(game);
+	return true;
+}
+
+//-------------------------------------------------------------------------------------
+// Make a move as above, filling in trace with where every tile went
+bool makeMove(Game &game, Direction direction, MoveTrace &trace)
+{
+	METRICS_ONLY(int emptyBefore = game.emptyCells.count());
+	METRICS_START(kernelTimer, TimerMoveKernel);
+	bool moved = slideBoard(game.board, game.squaresPerSide, direction, game.score, trace,
+		&game.emptyCells, &game.maxTile);
+	METRICS_STOP(kernelTimer);
+	if (!moved)
+	{
+		METRICS_COUNT(CounterRejectedMoves, 1);
+		return false;
+	}
+	METRICS_COUNT(CounterMerges, game.emptyCells.count() - emptyBefore);
+	finishMove(game);
+	return true;
+}
+
+//-------------------------------------------------------------------------------------
+// Whether any move is left.  With some squares open and some filled, a tile can
+// always slide towards an open square, so only a full board needs a closer look.
+bool hasLegalMove(const Game &game)
+{
+	int squares = game.squaresPerSide * game.squaresPerSide;
+	int empty = game.emptyCells.count();
+	if (empty > 0)
+	{
+		return empty < squares;
+	}
+	return hasLegalMove(game.board, game.squaresPerSide);
+}
+
+//-------------------------------------------------------------------------------------
+// Put a piece of any value on a square, as the 'p' command does
+void setGamePiece(Game &game, int index, int value)
+{
+	int oldValue = game.board[index];
+	game.emptyCells.update(index, oldValue, value);
+	setPiece(game.board, index, value);
+	if (value >= game.maxTile)
+	{
+		game.maxTile = value;
+	}
+	else if (oldValue == game.maxTile)
+	{
+		game.maxTile = largestTile(game.board, game.squaresPerSide);   // The largest tile may be gone
+	}
+}
+
+//-------------------------------------------------------------------------------------
+// Work out the open squares and the largest tile again, for after the whole board
+// has been replaced, as by an undo
+void refreshGameState(Game &game)
+{
+	game.emptyCells.reset(game.board, game.squaresPerSide);
+	game.maxTile = largestTile(game.board, game.squaresPerSide);
+}
+
+//-------------------------------------------------------------------------------------
+// Largest tile on the board
+int maxTileValue(const Game &game)
+{
+	return game.maxTile;
+}
+
+//-------------------------------------------------------------------------------------
+// Tile value that wins the game: 1024 for a 4x4 board, 2048 for 5x5, 4096 for 6x6, etc.
+int goalTileValue(int squaresPerSide)
+{
+	return raiseToThePowerOf(2, squaresPerSide - 4) * MaxTileStartValue;
+}
@@ -0,0 +1,38 @@
+//  game.h
+//     Headless game engine: everything needed to play a game of 1024 without a
+//     window or console.  A Game holds the complete state of one game, including its
+//     own random number stream, so any number of games can be played side by side on
+//     different threads.
+
+#ifndef GAME_H
+#define GAME_H
+
+#include <cstdint>
+#include "board.h"
+#include "emptycells.h"
+#include "gamerng.h"
+
+struct MoveTrace;
+
+struct Game
+{
+	int board[MaxBoardSize * MaxBoardSize];   // Squares of the board, row by row
+	int squaresPerSide;                       // Board size, from MinBoardSize to MaxBoardSize
+	int score;                                // Sum of the values of all merged tiles
+	int moveNumber;                           // Starts at 1, goes up with every move that changes the board
+	int lastSpawnSquare;                      // Square of the last random piece placed, or -1 if none was
+	int maxTile;                              // Largest tile on the board, kept up to date by the moves
+	EmptyCells emptyCells;                    // Open squares of the board
+	GameRng rng;                              // Where the new pieces come from
+};
+
+void newGame(Game &game, int squaresPerSide, uint64_t seed, uint64_t gameIndex);
+bool makeMove(Game &game, Direction direction);
+bool makeMove(Game &game, Direction direction, MoveTrace &trace);
+bool hasLegalMove(const Game &game);
+void setGamePiece(Game &game, int index, int value);
+void refreshGameState(Game &game);
+int maxTileValue(const Game &game);
+int goalTileValue(int squaresPerSide);
+
+#endif // GAME_H
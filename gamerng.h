@@ -0,0 +1,69 @@
+//  gamerng.h
+//     Random number stream for one game.  All of a game's randomness (which piece is
+//     placed and where) comes from its own GameRng, so a game can be replayed exactly
+//     from its seed, and many games can run on different threads with no shared state.
+//
+//     The generator is counter-based: the n-th number of a stream is a hash of the
+//     stream's key and n, using the SplitMix64 mixing function.  The key is derived
+//     from a seed and a game index, so the stream for game K of a run is known up
+//     front without generating the streams of games 0 .. K-1 first.
+
+#ifndef GAMERNG_H
+#define GAMERNG_H
+
+#include <cstdint>
+
+class GameRng
+{
+public:
+	GameRng() { reseed(0, 0); }
+	GameRng(uint64_t seed, uint64_t gameIndex) { reseed(seed, gameIndex); }
+
+	// Start the stream for game gameIndex of the run with the given seed
+	void reseed(uint64_t seed, uint64_t gameIndex)
+	{
+		this->seed = seed;
+		this->gameIndex = gameIndex;
+		key = mix(mix(seed) ^ (gameIndex * GoldenGamma + GoldenGamma));
+		counter = 0;
+	}
+
+	// Next 64 random bits of the stream
+	uint64_t next()
+	{
+		counter++;
+		return mix(key + counter * GoldenGamma);
+	}
+
+	// Random number from 0 to n-1, for n > 0.  Uses a multiply and shift rather
+	// than %, which is both faster and less biased for small n.
+	uint32_t nextBelow(uint32_t n)
+	{
+		return (uint32_t)(((next() >> 32) * n) >> 32);
+	}
+
+	// How many numbers have been drawn.  Restoring it with setPosition() makes the
+	// stream continue from the same place, for instance after an undo.
+	uint64_t getPosition() const { return counter; }
+	void setPosition(uint64_t position) { counter = position; }
+	uint64_t getSeed() const { return seed; }
+	uint64_t getGameIndex() const { return gameIndex; }
+
+private:
+	static const uint64_t GoldenGamma = 0x9E3779B97F4A7C15ULL;
+
+	// SplitMix64 finalizer
+	static uint64_t mix(uint64_t z)
+	{
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		return z ^ (z >> 31);
+	}
+
+	uint64_t seed;      // Seed of the run the stream belongs to
+	uint64_t gameIndex; // Game of the run the stream is for
+	uint64_t key;       // Derived from the seed and game index, fixed for the stream
+	uint64_t counter;   // Numbers drawn so far
+};
+
+#endif // GAMERNG_H
@@ -0,0 +1,260 @@
+//  history.cpp
+//     Undo/redo history tree.  See history.h.
+
+#include "history.h"
+#include "boardkernels.h"
+#include "metrics.h"
+
+
+//-------------------------------------------------------------------------------------
+// Forget any earlier history and start recording from the game's current state, as
+// the root of the tree and the start of line 0
+void GameHistory::start(const Game &game)
+{
+	squaresPerSide = game.squaresPerSide;
+	nodes.clear();
+	lineTips.clear();
+	checkpoints.clear();
+	checkpointBoards.clear();
+
+	Node root;
+	root.record.kind = RecordSetPiece;
+	root.record.direction = 0;
+	root.record.square = NoSquare;
+	root.record.unused = 0;
+	root.record.value = 0;
+	root.parent = -1;
+	root.jump = 0;
+	root.depth = 0;
+	root.moveNumber = game.moveNumber;
+	root.checkpoint = 0;
+	nodes.push_back(root);
+	lineTips.push_back(0);
+
+	Checkpoint checkpoint = { game.score };
+	checkpoints.push_back(checkpoint);
+	checkpointBoards.insert(checkpointBoards.end(), game.board,
+		game.board + squaresPerSide * squaresPerSide);
+
+	current = 0;
+	currentLine = 0;
+}
+
+//-------------------------------------------------------------------------------------
+// Record a move that changed the board.  after is the game once the move and its
+// random piece have been made.
+void GameHistory::recordMove(Direction direction, const Game &after)
+{
+	MoveRecord record;
+	record.kind = RecordMove;
+	record.direction = (uint8_t)direction;
+	record.unused = 0;
+	if (after.lastSpawnSquare >= 0)
+	{
+		record.square = (uint8_t)after.lastSpawnSquare;
+		record.value = after.board[after.lastSpawnSquare];
+	}
+	else
+	{
+		record.square = NoSquare;
+		record.value = 0;
+	}
+	addRecord(record, after);
+}
+
+//-------------------------------------------------------------------------------------
+// Record a piece set by hand
+void GameHistory::recordSetPiece(int square, int value, const Game &after)
+{
+	MoveRecord record;
+	record.kind = RecordSetPiece;
+	record.direction = 0;
+	record.square = (uint8_t)square;
+	record.unused = 0;
+	record.value = value;
+	addRecord(record, after);
+}
+
+//-------------------------------------------------------------------------------------
+// Add a record after the current node.  At the tip of the current line the line just
+// grows.  Part way along it, repeating the line's next record simply follows the
+// line; anything else branches off a new line, leaving the old one as it was.
+void GameHistory::addRecord(const MoveRecord &record, const Game &after)
+{
+	int tip = lineTips[currentLine];
+	if (current != tip)
+	{
+		int next = ancestorAtDepth(tip, nodes[current].depth + 1);
+		const MoveRecord &nextRecord = nodes[next].record;
+		if (nextRecord.kind == record.kind && nextRecord.direction == record.direction
+			&& nextRecord.square == record.square && nextRecord.value == record.value)
+		{
+			current = next;
+			return;
+		}
+		currentLine = (int)lineTips.size();
+		lineTips.push_back(current);
+	}
+
+	// The jump pointer skips to the parent's jump's jump when the parent's two jumps
+	// are the same length, and otherwise to the parent
+	const Node &parent = nodes[current];
+	const Node &parentJump = nodes[parent.jump];
+	Node node;
+	node.record = record;
+	node.parent = current;
+	if (parent.depth - parentJump.depth == parentJump.depth - nodes[parentJump.jump].depth)
+	{
+		node.jump = parentJump.jump;
+	}
+	else
+	{
+		node.jump = current;
+	}
+	node.depth = parent.depth + 1;
+	node.moveNumber = after.moveNumber;
+	node.checkpoint = -1;
+	if (node.depth % CheckpointInterval == 0)
+	{
+		node.checkpoint = (int)checkpoints.size();
+		Checkpoint checkpoint = { after.score };
+		checkpoints.push_back(checkpoint);
+		checkpointBoards.insert(checkpointBoards.end(), after.board,
+			after.board + squaresPerSide * squaresPerSide);
+	}
+
+	current = (int)nodes.size();
+	nodes.push_back(node);
+	lineTips[currentLine] = current;
+}
+
+//-------------------------------------------------------------------------------------
+// Ancestor of node at the given depth, which must be no deeper than node
+int GameHistory::ancestorAtDepth(int node, int depth) const
+{
+	while (nodes[node].depth > depth)
+	{
+		if (nodes[nodes[node].jump].depth >= depth)
+		{
+			node = nodes[node].jump;
+		}
+		else
+		{
+			node = nodes[node].parent;
+		}
+	}
+	return node;
+}
+
+//-------------------------------------------------------------------------------------
+// Rebuild in game the state at the given node, from the checkpoint at or above it.
+// The game's random stream is left as it is.
+void GameHistory::rebuild(int node, Game &game) const
+{
+	METRICS_START(restoreTimer, TimerRestore);
+	METRICS_COUNT(CounterRestores, 1);
+	int checkpointNode = ancestorAtDepth(node, nodes[node].depth / CheckpointInterval * CheckpointInterval);
+	const Checkpoint &checkpoint = checkpoints[nodes[checkpointNode].checkpoint];
+
+	// Nodes between the checkpoint and the target, newest first
+	int path[CheckpointInterval];
+	int pathLength = 0;
+	for (int i = node; i != checkpointNode; i = nodes[i].parent)
+	{
+		path[pathLength++] = i;
+	}
+
+	game.squaresPerSide = squaresPerSide;
+	game.score = checkpoint.score;
+	game.moveNumber = nodes[node].moveNumber;
+	game.lastSpawnSquare = -1;
+	copyBoard(&checkpointBoards[nodes[checkpointNode].checkpoint * squaresPerSide * squaresPerSide],
+		game.board, squaresPerSide);
+
+	for (int i = pathLength - 1; i >= 0; i--)
+	{
+		const MoveRecord &record = nodes[path[i]].record;
+		if (record.kind == RecordMove)
+		{
+			slideBoard(game.board, squaresPerSide, (Direction)record.direction, game.score);
+		}
+		if (record.square != NoSquare)
+		{
+			game.board[record.square] = record.value;
+		}
+	}
+	refreshGameState(game);
+}
+
+//-------------------------------------------------------------------------------------
+// Step back one record.  Returns false, leaving the game alone, at the start of the game.
+bool GameHistory::undo(Game &game)
+{
+	if (current == 0)
+	{
+		return false;
+	}
+	current = nodes[current].parent;
+	rebuild(current, game);
+	return true;
+}
+
+//-------------------------------------------------------------------------------------
+// Step forward one record along the current line.  Returns false, leaving the game
+// alone, at the tip of the line.
+bool GameHistory::redo(Game &game)
+{
+	int tip = lineTips[currentLine];
+	if (current == tip)
+	{
+		return false;
+	}
+	current = ancestorAtDepth(tip, nodes[current].depth + 1);
+	rebuild(current, game);
+	return true;
+}
+
+//-------------------------------------------------------------------------------------
+// Go to the given move of the given line, after any pieces set by hand during that
+// move, and make that line the current one.  Returns false, leaving the game alone,
+// if there is no such line or move.
+bool GameHistory::jumpToMove(int line, int moveNumber, Game &game)
+{
+	if (line < 0 || line >= (int)lineTips.size())
+	{
+		return false;
+	}
+	int node = lineTips[line];
+	if (moveNumber < nodes[0].moveNumber || moveNumber > nodes[node].moveNumber)
+	{
+		return false;
+	}
+
+	// Move numbers never go down along a line, so the jump pointers give a search
+	// for the deepest node at or before the move
+	while (nodes[node].moveNumber > moveNumber)
+	{
+		if (nodes[nodes[node].jump].moveNumber > moveNumber)
+		{
+			node = nodes[node].jump;
+		}
+		else
+		{
+			node = nodes[node].parent;
+		}
+	}
+	current = node;
+	currentLine = line;
+	rebuild(current, game);
+	return true;
+}
+
+//-------------------------------------------------------------------------------------
+// Memory held by the history
+size_t GameHistory::bytesUsed() const
+{
+	return nodes.capacity() * sizeof(Node)
+		+ lineTips.capacity() * sizeof(int)
+		+ checkpoints.capacity() * sizeof(Checkpoint)
+		+ checkpointBoards.capacity() * sizeof(int);
+}
@@ -0,0 +1,91 @@
+//  history.h
+//     Undo/redo history of a game, kept as a tree of moves so that lines abandoned
+//     by an undo are still there to go back to.
+//
+//     Every node of the tree is one 8-byte MoveRecord holding a move's direction and
+//     the square and value of the random piece placed after it.  Pieces set by hand
+//     ('p') are records too, so replaying the records always rebuilds the exact same
+//     boards.  Every node whose depth is a multiple of CheckpointInterval also keeps
+//     a full copy of the game (score, move number and board).  Branches share every
+//     node before the point where they split, so keeping many lines costs only their
+//     own moves.
+//
+//     Each line of play ends in a tip, and lines are numbered in the order they were
+//     started.  Every node has a parent and one jump pointer to a further ancestor
+//     (Myers' skew-binary scheme), so finding the ancestor at any depth or move
+//     number takes O(log n) steps.  Rebuilding a node's state then copies the
+//     checkpoint at or above it and replays at most CheckpointInterval - 1 records.
+
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "game.h"
+
+const int CheckpointInterval = 64;   // Depths between full checkpoints
+
+// What a MoveRecord describes
+enum RecordKind { RecordMove, RecordSetPiece };
+
+struct MoveRecord
+{
+	uint8_t kind;          // A RecordKind
+	uint8_t direction;     // For RecordMove, the Direction slid
+	uint8_t square;        // Square of the placed piece, or NoSquare if none was placed
+	uint8_t unused;
+	int32_t value;         // Value of the placed piece
+};
+
+const uint8_t NoSquare = 0xFF;   // MaxBoardSize * MaxBoardSize squares all fit below this
+
+class GameHistory
+{
+public:
+	GameHistory() { squaresPerSide = 0; current = 0; currentLine = 0; }
+
+	void start(const Game &game);
+	void recordMove(Direction direction, const Game &after);
+	void recordSetPiece(int square, int value, const Game &after);
+
+	bool undo(Game &game);
+	bool redo(Game &game);
+	bool jumpToMove(int line, int moveNumber, Game &game);
+
+	int getCurrentLine() const { return currentLine; }
+	int getNumberOfLines() const { return (int)lineTips.size(); }
+	int getLineMoves(int line) const { return nodes[lineTips[line]].moveNumber; }
+	int getDepth() const { return nodes[current].depth; }
+	size_t bytesUsed() const;
+
+private:
+	struct Node
+	{
+		MoveRecord record;     // How this node's state follows from its parent's
+		int parent;            // -1 for the root
+		int jump;              // Further ancestor, for O(log n) searches up the tree
+		int depth;             // Records from the root
+		int moveNumber;        // Move number of the game at this node
+		int checkpoint;        // Index of this node's checkpoint, or -1 if it has none
+	};
+
+	struct Checkpoint
+	{
+		int score;
+	};
+
+	void addRecord(const MoveRecord &record, const Game &after);
+	int ancestorAtDepth(int node, int depth) const;
+	void rebuild(int node, Game &game) const;
+
+	int squaresPerSide;
+	int current;                            // Node of the game's current state
+	int currentLine;                        // Line that undo and redo move along; current is on it
+	std::vector<Node> nodes;                // Node 0 is the start of the game
+	std::vector<int> lineTips;              // Last node of each line
+	std::vector<Checkpoint> checkpoints;
+	std::vector<int> checkpointBoards;      // Board of checkpoint i starts at i * squaresPerSide^2
+};
+
+#endif // HISTORY_H
@@ -0,0 +1,358 @@
+//  metrics.cpp
+//     Engine metrics.  See metrics.h.
+
+#include "metrics.h"
+
+#ifdef G1024_METRICS
+
+#include "bitboard.h"        // For highestSetBit
+#include <cstdio>
+#include <vector>
+#include <algorithm>
+
+// Names in snapshots, indexed by MetricCounter, MetricGauge and MetricTimer
+static const char *CounterNames[NumberOfCounters] = {
+	"moves", "rejected_moves", "merges", "restores", "frames"
+};
+static const char *GaugeNames[NumberOfGauges] = { "history_bytes", "history_depth" };
+static const char *TimerNames[NumberOfTimers] = {
+	"move_kernel", "spawn", "restore", "render_frame", "input_wait"
+};
+
+const int NumberOfQuantiles = 4;
+static const double Quantiles[NumberOfQuantiles] = { 0.5, 0.9, 0.99, 0.999 };
+static const char *QuantileNames[NumberOfQuantiles] = { "p50", "p90", "p99", "p999" };
+
+//-------------------------------------------------------------------------------------
+// Counts of one thread, written only by that thread
+struct ThreadMetrics
+{
+	std::atomic<int64_t> counters[NumberOfCounters];
+	std::atomic<int64_t> timerSums[NumberOfTimers];       // Nanoseconds
+	std::atomic<int64_t> timerMaxima[NumberOfTimers];
+	std::atomic<int64_t> buckets[NumberOfTimers][HistogramBuckets];
+
+	ThreadMetrics()
+	{
+		for (int c = 0; c < NumberOfCounters; c++)
+		{
+			counters[c].store(0, std::memory_order_relaxed);
+		}
+		for (int t = 0; t < NumberOfTimers; t++)
+		{
+			timerSums[t].store(0, std::memory_order_relaxed);
+			timerMaxima[t].store(0, std::memory_order_relaxed);
+			for (int b = 0; b < HistogramBuckets; b++)
+			{
+				buckets[t][b].store(0, std::memory_order_relaxed);
+			}
+		}
+	}
+};
+
+//-------------------------------------------------------------------------------------
+// Every thread's counts added together
+struct MetricsSnapshot
+{
+	int64_t counters[NumberOfCounters];
+	int64_t gauges[NumberOfGauges];
+	int64_t timerCounts[NumberOfTimers];
+	int64_t timerSums[NumberOfTimers];
+	int64_t timerMaxima[NumberOfTimers];
+	std::vector<int64_t> buckets[NumberOfTimers];
+};
+
+static std::atomic<int64_t> Gauges[NumberOfGauges];
+
+//-------------------------------------------------------------------------------------
+// Blocks of every thread that has counted anything.  Never freed, so a snapshot can
+// still read the blocks of threads that have ended.
+static std::mutex &registryLock()
+{
+	static std::mutex lock;
+	return lock;
+}
+
+static std::vector<ThreadMetrics *> &registry()
+{
+	static std::vector<ThreadMetrics *> blocks;
+	return blocks;
+}
+
+//-------------------------------------------------------------------------------------
+// The calling thread's block, made and registered on its first use
+static ThreadMetrics &threadMetrics()
+{
+	thread_local ThreadMetrics *metrics = NULL;
+	if (metrics == NULL)
+	{
+		metrics = new ThreadMetrics;
+		std::lock_guard<std::mutex> guard(registryLock());
+		registry().push_back(metrics);
+	}
+	return *metrics;
+}
+
+//-------------------------------------------------------------------------------------
+// Add to a value only this thread writes.  A load and a store, with no locked
+// instruction, since no other thread can change it in between.
+static inline void addOwned(std::atomic<int64_t> &value, int64_t amount)
+{
+	value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+//-------------------------------------------------------------------------------------
+// Histogram bucket of a value: the value itself below HistogramSubBuckets, and above
+// that the power of two it falls in and the next HistogramSubBits bits below its top
+// bit
+static int histogramBucket(uint64_t value)
+{
+	if (value < (uint64_t)HistogramSubBuckets)
+	{
+		return (int)value;
+	}
+	int exponent = highestSetBit(value);
+	return (exponent - HistogramSubBits + 1) * HistogramSubBuckets
+		+ (int)((value >> (exponent - HistogramSubBits)) & (HistogramSubBuckets - 1));
+}
+
+//-------------------------------------------------------------------------------------
+// Largest value that falls in a bucket
+static uint64_t bucketHighestValue(int bucket)
+{
+	if (bucket < HistogramSubBuckets)
+	{
+		return (uint64_t)bucket;
+	}
+	int shift = bucket / HistogramSubBuckets - 1;
+	uint64_t next = (uint64_t)(HistogramSubBuckets + bucket % HistogramSubBuckets + 1) << shift;
+	return next - 1;
+}
+
+//-------------------------------------------------------------------------------------
+void countMetric(MetricCounter counter, int64_t amount)
+{
+	addOwned(threadMetrics().counters[counter], amount);
+}
+
+//-------------------------------------------------------------------------------------
+void setMetricGauge(MetricGauge gauge, int64_t value)
+{
+	Gauges[gauge].store(value, std::memory_order_relaxed);
+}
+
+//-------------------------------------------------------------------------------------
+void recordMetricTime(MetricTimer timer, int64_t nanoseconds)
+{
+	ThreadMetrics &metrics = threadMetrics();
+	nanoseconds = std::max<int64_t>(nanoseconds, 0);
+	addOwned(metrics.buckets[timer][histogramBucket((uint64_t)nanoseconds)], 1);
+	addOwned(metrics.timerSums[timer], nanoseconds);
+	if (nanoseconds > metrics.timerMaxima[timer].load(std::memory_order_relaxed))
+	{
+		metrics.timerMaxima[timer].store(nanoseconds, std::memory_order_relaxed);
+	}
+}
+
+//-------------------------------------------------------------------------------------
+// Add up every thread's counts.  A thread counting at the same time may have some
+// of its latest counts in and some not, which is fine for a snapshot.
+static void takeSnapshot(MetricsSnapshot &snapshot)
+{
+	for (int c = 0; c < NumberOfCounters; c++)
+	{
+		snapshot.counters[c] = 0;
+	}
+	for (int g = 0; g < NumberOfGauges; g++)
+	{
+		snapshot.gauges[g] = Gauges[g].load(std::memory_order_relaxed);
+	}
+	for (int t = 0; t < NumberOfTimers; t++)
+	{
+		snapshot.timerSums[t] = 0;
+		snapshot.timerMaxima[t] = 0;
+		snapshot.buckets[t].assign(HistogramBuckets, 0);
+	}
+
+	std::lock_guard<std::mutex> guard(registryLock());
+	const std::vector<ThreadMetrics *> &blocks = registry();
+	for (size_t i = 0; i < blocks.size(); i++)
+	{
+		const ThreadMetrics &metrics = *blocks[i];
+		for (int c = 0; c < NumberOfCounters; c++)
+		{
+			snapshot.counters[c] += metrics.counters[c].load(std::memory_order_relaxed);
+		}
+		for (int t = 0; t < NumberOfTimers; t++)
+		{
+			snapshot.timerSums[t] += metrics.timerSums[t].load(std::memory_order_relaxed);
+			snapshot.timerMaxima[t] = std::max(snapshot.timerMaxima[t],
+				metrics.timerMaxima[t].load(std::memory_order_relaxed));
+			for (int b = 0; b < HistogramBuckets; b++)
+			{
+				snapshot.buckets[t][b] += metrics.buckets[t][b].load(std::memory_order_relaxed);
+			}
+		}
+	}
+	for (int t = 0; t < NumberOfTimers; t++)
+	{
+		snapshot.timerCounts[t] = 0;
+		for (int b = 0; b < HistogramBuckets; b++)
+		{
+			snapshot.timerCounts[t] += snapshot.buckets[t][b];
+		}
+	}
+}
+
+//-------------------------------------------------------------------------------------
+// Value at fraction q (0 to 1) of the way through a timer's values, to the precision
+// of its histogram, and never above the largest value recorded
+static int64_t timerQuantile(const MetricsSnapshot &snapshot, int timer, double q)
+{
+	int64_t count = snapshot.timerCounts[timer];
+	if (count == 0)
+	{
+		return 0;
+	}
+	int64_t rank = std::max<int64_t>(1, (int64_t)(q * count + 0.5));
+	int64_t seen = 0;
+	for (int b = 0; b < HistogramBuckets; b++)
+	{
+		seen += snapshot.buckets[timer][b];
+		if (seen >= rank)
+		{
+			return std::min((int64_t)bucketHighestValue(b), snapshot.timerMaxima[timer]);
+		}
+	}
+	return snapshot.timerMaxima[timer];
+}
+
+//-------------------------------------------------------------------------------------
+static void writeJson(FILE *file, const MetricsSnapshot &snapshot)
+{
+	fprintf(file, "{\n  \"counters\": {");
+	for (int c = 0; c < NumberOfCounters; c++)
+	{
+		fprintf(file, "%s\n    \"%s\": %lld", (c > 0) ? "," : "", CounterNames[c], (long long)snapshot.counters[c]);
+	}
+	fprintf(file, "\n  },\n  \"gauges\": {");
+	for (int g = 0; g < NumberOfGauges; g++)
+	{
+		fprintf(file, "%s\n    \"%s\": %lld", (g > 0) ? "," : "", GaugeNames[g], (long long)snapshot.gauges[g]);
+	}
+	fprintf(file, "\n  },\n  \"timers\": {");
+	for (int t = 0; t < NumberOfTimers; t++)
+	{
+		fprintf(file, "%s\n    \"%s\": { \"count\": %lld, \"sum_ns\": %lld, \"max_ns\": %lld",
+			(t > 0) ? "," : "", TimerNames[t], (long long)snapshot.timerCounts[t],
+			(long long)snapshot.timerSums[t], (long long)snapshot.timerMaxima[t]);
+		for (int q = 0; q < NumberOfQuantiles; q++)
+		{
+			fprintf(file, ", \"%s_ns\": %lld", QuantileNames[q], (long long)timerQuantile(snapshot, t, Quantiles[q]));
+		}
+		fprintf(file, " }");
+	}
+	fprintf(file, "\n  }\n}\n");
+}
+
+//-------------------------------------------------------------------------------------
+// Prometheus text exposition: counters as counters, gauges as gauges, and timers as
+// summaries in seconds
+static void writePrometheus(FILE *file, const MetricsSnapshot &snapshot)
+{
+	for (int c = 0; c < NumberOfCounters; c++)
+	{
+		fprintf(file, "# TYPE g1024_%s_total counter\ng1024_%s_total %lld\n",
+			CounterNames[c], CounterNames[c], (long long)snapshot.counters[c]);
+	}
+	for (int g = 0; g < NumberOfGauges; g++)
+	{
+		fprintf(file, "# TYPE g1024_%s gauge\ng1024_%s %lld\n",
+			GaugeNames[g], GaugeNames[g], (long long)snapshot.gauges[g]);
+	}
+	for (int t = 0; t < NumberOfTimers; t++)
+	{
+		const char *name = TimerNames[t];
+		fprintf(file, "# TYPE g1024_%s_seconds summary\n", name);
+		for (int q = 0; q < NumberOfQuantiles; q++)
+		{
+			fprintf(file, "g1024_%s_seconds{quantile=\"%g\"} %.9f\n", name, Quantiles[q],
+				timerQuantile(snapshot, t, Quantiles[q]) * 1e-9);
+		}
+		fprintf(file, "g1024_%s_seconds_sum %.9f\ng1024_%s_seconds_count %lld\n",
+			name, snapshot.timerSums[t] * 1e-9, name, (long long)snapshot.timerCounts[t]);
+	}
+}
+
+
+//-------------------------------------------------------------------------------------
+// Write a snapshot to the file every intervalMillis, until stopped
+void MetricsDumper::start(const char *path, MetricsFormat format, int intervalMillis)
+{
+	stop();
+	this->path = path;
+	this->format = format;
+	this->intervalMillis = std::max(1, intervalMillis);
+	stopping = false;
+	writer = std::thread(&MetricsDumper::run, this);
+}
+
+//-------------------------------------------------------------------------------------
+void MetricsDumper::stop()
+{
+	if (!writer.joinable())
+	{
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		stopping = true;
+	}
+	wake.notify_one();
+	writer.join();
+	writeSnapshot();
+}
+
+//-------------------------------------------------------------------------------------
+void MetricsDumper::run()
+{
+	std::unique_lock<std::mutex> guard(lock);
+	while (!wake.wait_for(guard, std::chrono::milliseconds(intervalMillis), [this] { return stopping; }))
+	{
+		guard.unlock();
+		writeSnapshot();
+		guard.lock();
+	}
+}
+
+//-------------------------------------------------------------------------------------
+// Write a snapshot to path.tmp, then put it in place of the file
+bool MetricsDumper::writeSnapshot() const
+{
+	MetricsSnapshot snapshot;
+	takeSnapshot(snapshot);
+	std::string temporary = path + ".tmp";
+	FILE *file = fopen(temporary.c_str(), "w");
+	if (file == NULL)
+	{
+		return false;
+	}
+	if (format == MetricsPrometheus)
+	{
+		writePrometheus(file, snapshot);
+	}
+	else
+	{
+		writeJson(file, snapshot);
+	}
+	if (fclose(file) != 0)
+	{
+		return false;
+	}
+#ifdef _WIN32
+	remove(path.c_str());   // Windows will not rename over a file
+#endif
+	return rename(temporary.c_str(), path.c_str()) == 0;
+}
+
+#endif // G1024_METRICS
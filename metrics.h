@@ -0,0 +1,146 @@
+//  metrics.h
+//     Counters and latency histograms for seeing where the game's time goes, written
+//     to a file every so often while the game runs.  Compiled in only when
+//     G1024_METRICS is defined; otherwise every METRICS_ macro below is empty, so the
+//     engine and the batch mode run exactly as fast as they would without them.
+//
+//     Each thread counts into a block of its own, made the first time it counts
+//     anything, so counting is a plain add with no sharing between threads.  A block
+//     is only ever written by its thread; the values are atomics so that a snapshot
+//     can read them from another thread while they change.  Blocks stay registered
+//     after their thread ends, so nothing counted is lost.
+//
+//     A timer records nanoseconds into a log-linear (HDR-style) histogram: values
+//     below 16 have a bucket each, and every power of two above that is split into
+//     16 equal buckets, so any value is known to within 1/16 of itself whatever its
+//     size, in a fixed 976 buckets with no upper limit to set.
+//
+//     A MetricsDumper writes a snapshot of every thread's counts added together, as
+//     JSON or as Prometheus text exposition, every interval and once more when
+//     stopped.  Each snapshot is written to FILE.tmp and renamed over FILE, so a
+//     reader never sees one half written.
+//
+//     Started from the command line with:
+//        1024 --metrics FILE [--metrics-format json|prometheus]
+//     ahead of any other options of the interactive game.
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <cstdint>
+
+// Events counted
+enum MetricCounter
+{
+	CounterMoves,            // Moves that changed the board
+	CounterRejectedMoves,    // Moves tried that did not change the board
+	CounterMerges,           // Pairs of tiles merged
+	CounterRestores,         // Boards rebuilt from the history, by undo, redo or jump
+	CounterFrames,           // Frames drawn by the window
+	NumberOfCounters
+};
+
+// Values set rather than added to
+enum MetricGauge
+{
+	GaugeHistoryBytes,       // Memory the undo history takes
+	GaugeHistoryDepth,       // Records from the start of the game to the current one
+	NumberOfGauges
+};
+
+// Stretches of time measured
+enum MetricTimer
+{
+	TimerMoveKernel,         // Sliding the tiles of one move
+	TimerSpawn,              // Placing the new piece after a move
+	TimerRestore,            // Rebuilding a board from the history
+	TimerRenderFrame,        // Drawing one frame, up to handing it to the display
+	TimerInputWait,          // The engine waiting for the next command
+	NumberOfTimers
+};
+
+enum MetricsFormat { MetricsJson, MetricsPrometheus };
+
+#ifdef G1024_METRICS
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+const int HistogramSubBits = 4;                             // Buckets per power of two = 2^4
+const int HistogramSubBuckets = 1 << HistogramSubBits;
+const int HistogramBuckets = (64 - HistogramSubBits + 1) * HistogramSubBuckets;
+
+void countMetric(MetricCounter counter, int64_t amount);
+void setMetricGauge(MetricGauge gauge, int64_t value);
+void recordMetricTime(MetricTimer timer, int64_t nanoseconds);
+
+//-------------------------------------------------------------------------------------
+// Measures from its construction to stop(), or to its destruction if never stopped
+class MetricsStopwatch
+{
+public:
+	explicit MetricsStopwatch(MetricTimer timer)
+		: timer(timer), running(true), start(std::chrono::steady_clock::now()) { }
+	~MetricsStopwatch() { stop(); }
+
+	void stop()
+	{
+		if (running)
+		{
+			running = false;
+			std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - start;
+			recordMetricTime(timer, elapsed.count());
+		}
+	}
+
+private:
+	MetricTimer timer;
+	bool running;
+	std::chrono::steady_clock::time_point start;
+};
+
+//-------------------------------------------------------------------------------------
+// Writes snapshots to a file on a thread of its own
+class MetricsDumper
+{
+public:
+	MetricsDumper() : format(MetricsJson), intervalMillis(0), stopping(false) { }
+	~MetricsDumper() { stop(); }
+
+	void start(const char *path, MetricsFormat format, int intervalMillis);
+	void stop();   // Writes a last snapshot
+
+private:
+	void run();
+	bool writeSnapshot() const;
+
+	std::string path;
+	MetricsFormat format;
+	int intervalMillis;
+	std::thread writer;
+	std::mutex lock;
+	std::condition_variable wake;
+	bool stopping;
+};
+
+#define METRICS_COUNT(counter, amount) countMetric(counter, amount)
+#define METRICS_GAUGE(gauge, value) setMetricGauge(gauge, value)
+#define METRICS_START(name, timer) MetricsStopwatch name(timer)
+#define METRICS_STOP(name) name.stop()
+#define METRICS_ONLY(statement) statement
+
+#else
+
+#define METRICS_COUNT(counter, amount) ((void)0)
+#define METRICS_GAUGE(gauge, value) ((void)0)
+#define METRICS_START(name, timer) ((void)0)
+#define METRICS_STOP(name) ((void)0)
+#define METRICS_ONLY(statement)
+
+#endif // G1024_METRICS
+
+#endif // METRICS_H
@@ -0,0 +1,182 @@
+//  montecarlo.cpp
+//     Pure Monte Carlo player.  See montecarlo.h.
+
+#include "montecarlo.h"
+#include "simulation.h"
+#include "boardkernels.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+const int RolloutsPerTask = 16;         // Rollouts played by each task on the pool
+const int MovesBetweenChecks = 256;     // Rollout moves played between looks at the clock
+
+typedef std::chrono::steady_clock Clock;
+
+// Running totals for one first move, added to by every task playing its rollouts
+struct RolloutTotals
+{
+	std::atomic<int64_t> rollouts;
+	std::atomic<int64_t> scoreSum;
+};
+
+
+//-------------------------------------------------------------------------------------
+// Play one rollout: random moves until the game is over or maxRolloutMoves moves
+// have been made.  Returns false if the deadline passed first, in which case the
+// rollout is abandoned.  Large boards can take hundreds of thousands of moves to
+// fill, so the clock is checked every MovesBetweenChecks moves.
+static bool playRollout(Game &game, bool hasDeadline, Clock::time_point deadline,
+	int maxRolloutMoves)
+{
+	int64_t moves = 0;
+	while (maxRolloutMoves == 0 || moves < maxRolloutMoves)
+	{
+		int64_t limit = MovesBetweenChecks;
+		if (maxRolloutMoves != 0)
+		{
+			limit = std::min(limit, maxRolloutMoves - moves);
+		}
+		int64_t played = playGame(game, PolicyRandom, limit);
+		moves += played;
+		if (played < limit)
+		{
+			break;   // Game over
+		}
+		if (hasDeadline && Clock::now() >= deadline)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+//-------------------------------------------------------------------------------------
+// Play count rollouts that start with the move first.  Rollout r uses random stream
+// firstRollout + r of streamSeed, so the rollouts do not depend on which thread
+// plays them.  Stops early once the deadline has passed.
+static void playRollouts(const Game &start, Direction first, uint64_t streamSeed,
+	int firstRollout, int count, bool hasDeadline, Clock::time_point deadline,
+	int maxRolloutMoves, RolloutTotals &totals)
+{
+	Game game;
+	int64_t rollouts = 0;
+	int64_t scoreSum = 0;
+	for (int r = 0; r < count; r++)
+	{
+		if (hasDeadline && Clock::now() >= deadline)
+		{
+			break;
+		}
+		game = start;
+		game.rng.reseed(streamSeed, (uint64_t)first * 0x100000000ULL + firstRollout + r);
+		makeMove(game, first);
+		if (!playRollout(game, hasDeadline, deadline, maxRolloutMoves))
+		{
+			break;
+		}
+		scoreSum += game.score;
+		rollouts++;
+	}
+	totals.rollouts += rollouts;
+	totals.scoreSum += scoreSum;
+}
+
+//-------------------------------------------------------------------------------------
+// Default settings for a board size.  Random games on a 4x4 board last a hundred or
+// so moves and are played to the end; on larger boards they run for many thousands
+// of moves, so rollouts are cut off after RolloutMovesPerSquare moves per square and
+// compared by the score reached by then.
+MonteCarloConfig monteCarloConfigForSize(int squaresPerSide)
+{
+	const int RolloutMovesPerSquare = 10;
+	MonteCarloConfig config;
+	if (squaresPerSide > 4)
+	{
+		config.maxRolloutMoves = RolloutMovesPerSquare * squaresPerSide * squaresPerSide;
+	}
+	return config;
+}
+
+//-------------------------------------------------------------------------------------
+// Direction whose rollouts reach the best mean score, with the default settings for
+// the game's board size
+MonteCarloResult monteCarloBestMove(const Game &game)
+{
+	return monteCarloBestMove(game, monteCarloConfigForSize(game.squaresPerSide));
+}
+
+//-------------------------------------------------------------------------------------
+// Direction whose random rollouts reach the best mean final score
+MonteCarloResult monteCarloBestMove(const Game &game, const MonteCarloConfig &config)
+{
+	MonteCarloResult result;
+	result.found = false;
+	result.bestMove = DirectionLeft;
+	result.totalRollouts = 0;
+
+	// Only directions that change the board are worth playing out
+	AllMoves moves;
+	slideAllDirections(game.board, game.squaresPerSide, moves);
+	const bool *legal = moves.changed;
+	for (int d = 0; d < NumberOfDirections; d++)
+	{
+		result.meanScore[d] = 0;
+		result.rollouts[d] = 0;
+	}
+
+	// Rollouts get their own streams, different for every decision of the game
+	uint64_t streamSeed = game.rng.getSeed() ^ ((game.rng.getPosition() + 1) * 0x9E3779B97F4A7C15ULL);
+	bool hasDeadline = (config.timeBudgetMs > 0);
+	Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(config.timeBudgetMs);
+
+	RolloutTotals totals[NumberOfDirections];
+	for (int d = 0; d < NumberOfDirections; d++)
+	{
+		totals[d].rollouts = 0;
+		totals[d].scoreSum = 0;
+	}
+
+	// Queue the tasks of the four directions in turn, so that if the time runs out
+	// each direction has had about the same number of rollouts
+	{
+		TaskGroup group(WorkStealingPool::shared());
+		for (int first = 0; first < config.rolloutsPerMove; first += RolloutsPerTask)
+		{
+			int count = std::min(RolloutsPerTask, config.rolloutsPerMove - first);
+			for (int d = 0; d < NumberOfDirections; d++)
+			{
+				if (legal[d])
+				{
+					RolloutTotals &directionTotals = totals[d];
+					group.run([&game, d, streamSeed, first, count, hasDeadline, deadline,
+						&config, &directionTotals]() {
+						playRollouts(game, (Direction)d, streamSeed, first, count,
+							hasDeadline, deadline, config.maxRolloutMoves, directionTotals);
+					});
+				}
+			}
+		}
+		group.wait();
+	}
+
+	for (int d = 0; d < NumberOfDirections; d++)
+	{
+		result.rollouts[d] = totals[d].rollouts;
+		result.totalRollouts += result.rollouts[d];
+		if (!legal[d])
+		{
+			continue;
+		}
+		// A direction whose rollouts all missed the deadline still beats no move at all
+		result.meanScore[d] = (result.rollouts[d] > 0)
+			? (double)totals[d].scoreSum / result.rollouts[d] : 0.0;
+		if (!result.found || result.meanScore[d] > result.meanScore[result.bestMove])
+		{
+			result.found = true;
+			result.bestMove = (Direction)d;
+		}
+	}
+	return result;
+}
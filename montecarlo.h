@@ -0,0 +1,39 @@
+//  montecarlo.h
+//     Pure Monte Carlo player.  For each direction that changes the board, play many
+//     random games (rollouts) to the end starting with that move, and pick the
+//     direction whose rollouts have the best mean final score.  No position
+//     evaluation is needed, so it copes with boards far too large for a deep search.
+//
+//     The rollouts of one decision are split into small tasks on the shared
+//     work-stealing pool, so a single decision uses every core, and tasks that start
+//     after the time budget has run out return at once.
+
+#ifndef MONTECARLO_H
+#define MONTECARLO_H
+
+#include <cstdint>
+#include "game.h"
+
+struct MonteCarloConfig
+{
+	int rolloutsPerMove;     // Most rollouts to play for each direction
+	int timeBudgetMs;        // Stop starting new rollouts after this long; 0 for no limit
+	int maxRolloutMoves;     // Cut rollouts off after this many moves; 0 plays to the end
+
+	MonteCarloConfig() { rolloutsPerMove = 1000; timeBudgetMs = 100; maxRolloutMoves = 0; }
+};
+
+struct MonteCarloResult
+{
+	bool found;                                   // False if no direction changes the board
+	Direction bestMove;
+	double meanScore[NumberOfDirections];         // Mean final score of each direction's rollouts
+	int64_t rollouts[NumberOfDirections];         // Rollouts played for each direction
+	int64_t totalRollouts;
+};
+
+MonteCarloConfig monteCarloConfigForSize(int squaresPerSide);
+MonteCarloResult monteCarloBestMove(const Game &game, const MonteCarloConfig &config);
+MonteCarloResult monteCarloBestMove(const Game &game);
+
+#endif // MONTECARLO_H
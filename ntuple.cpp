@@ -0,0 +1,424 @@
+//  ntuple.cpp
+//     N-tuple network and its trainer.  See ntuple.h.
+
+#include "ntuple.h"
+#include "game.h"
+#include "zobrist.h"
+#include <iostream>
+#include <iomanip>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <string>
+
+// Squares of each tuple, in the order their exponents make up its index, on the
+// board as seen through each symmetry
+static const uint8_t TupleSquareList[NumberOfTuples][TupleSquares] = {
+	{ 0, 1, 2, 3 },      // Outer row
+	{ 4, 5, 6, 7 },      // Second row
+	{ 0, 1, 4, 5 },      // Corner square
+	{ 1, 2, 5, 6 },      // Edge square
+	{ 5, 6, 9, 10 }      // Middle square
+};
+
+const int CacheLineFloats = 16;
+const double DefaultLearningRate = 0.0025;
+
+
+//-------------------------------------------------------------------------------------
+// Index into each tuple's table for the board as it is, from the exponents of the
+// tuple's squares, a nibble each.  The rows are 16-bit chunks of the board already,
+// and a 2x2 square is two bytes of neighboring rows.  Must match TupleSquareList.
+static inline void tupleIndexes(Bitboard board, unsigned indexes[])
+{
+	indexes[0] = (unsigned)(board & 0xFFFF);
+	indexes[1] = (unsigned)((board >> 16) & 0xFFFF);
+	indexes[2] = (unsigned)((board & 0xFF) | ((board >> 8) & 0xFF00));
+	indexes[3] = (unsigned)(((board >> 4) & 0xFF) | ((board >> 12) & 0xFF00));
+	indexes[4] = (unsigned)(((board >> 20) & 0xFF) | ((board >> 28) & 0xFF00));
+}
+
+//-------------------------------------------------------------------------------------
+// Sum of the weights of every tuple for the board as it is.  The same indexes as
+// tupleIndexes(), written out so they stay in registers.
+static inline float tupleSum(const std::atomic<float> weights[], Bitboard board)
+{
+	return weights[board & 0xFFFF].load(std::memory_order_relaxed)
+		+ weights[TupleWeights + ((board >> 16) & 0xFFFF)].load(std::memory_order_relaxed)
+		+ weights[2 * TupleWeights + ((board & 0xFF) | ((board >> 8) & 0xFF00))].load(std::memory_order_relaxed)
+		+ weights[3 * TupleWeights + (((board >> 4) & 0xFF) | ((board >> 12) & 0xFF00))].load(std::memory_order_relaxed)
+		+ weights[4 * TupleWeights + (((board >> 20) & 0xFF) | ((board >> 28) & 0xFF00))].load(std::memory_order_relaxed);
+}
+
+//-------------------------------------------------------------------------------------
+// SplitMix64 finalizer, to fold the weights into a fingerprint
+static uint64_t mixFingerprint(uint64_t z)
+{
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+
+//-------------------------------------------------------------------------------------
+// A network with every weight 0
+NTupleNetwork::NTupleNetwork()
+	: storage((size_t)NumberOfTuples * TupleWeights + CacheLineFloats)
+{
+	for (size_t i = 0; i < storage.size(); i++)
+	{
+		storage[i].store(0.0f, std::memory_order_relaxed);
+	}
+	uintptr_t address = (uintptr_t)storage.data();
+	weights = storage.data() + (CacheLineFloats - address / sizeof(float) % CacheLineFloats) % CacheLineFloats;
+	computeFingerprint();
+}
+
+//-------------------------------------------------------------------------------------
+// Points still to come after a move left the given board, before the random piece
+double NTupleNetwork::evaluate(Bitboard board) const
+{
+	Bitboard turned[NumberOfSymmetries];
+	bitboardSymmetries(board, turned);
+	float value = 0;
+	for (int s = 0; s < NumberOfSymmetries; s++)
+	{
+		value += tupleSum(weights, turned[s]);
+	}
+	return value;
+}
+
+//-------------------------------------------------------------------------------------
+// Add change to every weight the board's value is made of.  Other threads may be
+// changing the same weights; an update lost to a race does no harm.
+void NTupleNetwork::update(Bitboard board, double change)
+{
+	Bitboard turned[NumberOfSymmetries];
+	bitboardSymmetries(board, turned);
+	for (int s = 0; s < NumberOfSymmetries; s++)
+	{
+		unsigned indexes[NumberOfTuples];
+		tupleIndexes(turned[s], indexes);
+		for (int t = 0; t < NumberOfTuples; t++)
+		{
+			std::atomic<float> &weight = weights[t * TupleWeights + indexes[t]];
+			weight.store(weight.load(std::memory_order_relaxed) + (float)change, std::memory_order_relaxed);
+		}
+	}
+}
+
+//-------------------------------------------------------------------------------------
+void NTupleNetwork::computeFingerprint()
+{
+	fingerprint = mixFingerprint(NTupleVersion);
+	for (size_t i = 0; i < (size_t)NumberOfTuples * TupleWeights; i++)
+	{
+		float weight = weights[i].load(std::memory_order_relaxed);
+		uint32_t bits;
+		memcpy(&bits, &weight, sizeof(bits));
+		fingerprint = mixFingerprint(fingerprint ^ bits);
+	}
+}
+
+//-------------------------------------------------------------------------------------
+// Read the weights from a network file.  Returns false, leaving the weights as they
+// were, if the file cannot be read or holds a network with other tuples.
+bool NTupleNetwork::load(const char *path)
+{
+	FILE *file = fopen(path, "rb");
+	if (file == NULL)
+	{
+		return false;
+	}
+	NTupleFileHeader header;
+	uint8_t squares[NumberOfTuples][TupleSquares];
+	std::vector<float> values((size_t)NumberOfTuples * TupleWeights);
+	bool ok = fread(&header, sizeof(header), 1, file) == 1
+		&& header.magic == NTupleMagic && header.version == NTupleVersion
+		&& header.numberOfTuples == (uint32_t)NumberOfTuples && header.tupleSquares == (uint32_t)TupleSquares
+		&& fread(squares, sizeof(squares), 1, file) == 1
+		&& memcmp(squares, TupleSquareList, sizeof(squares)) == 0
+		&& fread(values.data(), sizeof(float), values.size(), file) == values.size();
+	fclose(file);
+	if (!ok)
+	{
+		return false;
+	}
+	for (size_t i = 0; i < values.size(); i++)
+	{
+		weights[i].store(values[i], std::memory_order_relaxed);
+	}
+	computeFingerprint();
+	return true;
+}
+
+//-------------------------------------------------------------------------------------
+// Write the weights to a network file, through a temporary file so the old one stays
+// whole until the new one is, and take the fingerprint of what was written
+bool NTupleNetwork::save(const char *path)
+{
+	std::string temporary = std::string(path) + ".tmp";
+	FILE *file = fopen(temporary.c_str(), "wb");
+	if (file == NULL)
+	{
+		return false;
+	}
+	NTupleFileHeader header = { NTupleMagic, NTupleVersion, NumberOfTuples, TupleSquares };
+	std::vector<float> values((size_t)NumberOfTuples * TupleWeights);
+	for (size_t i = 0; i < values.size(); i++)
+	{
+		values[i] = weights[i].load(std::memory_order_relaxed);
+	}
+	bool ok = fwrite(&header, sizeof(header), 1, file) == 1
+		&& fwrite(TupleSquareList, sizeof(TupleSquareList), 1, file) == 1
+		&& fwrite(values.data(), sizeof(float), values.size(), file) == values.size();
+	ok = (fclose(file) == 0) && ok;
+	if (!ok)
+	{
+		remove(temporary.c_str());
+		return false;
+	}
+#ifdef _WIN32
+	remove(path);   // Windows will not rename over a file
+#endif
+	if (rename(temporary.c_str(), path) != 0)
+	{
+		return false;
+	}
+	computeFingerprint();
+	return true;
+}
+
+
+//-------------------------------------------------------------------------------------
+// The move scoring the most points plus the value of the board it leaves, found
+// from all four moves made at once.  Fills in the boards after the moves, their
+// points, and the best one's total; returns false if no move changes the board.
+static bool bestMove(const NTupleNetwork &network, Bitboard board, Bitboard after[], int gains[],
+	Direction &best, double &bestValue)
+{
+	bitboardSlideAll(board, after, gains);
+	bool found = false;
+	for (int d = 0; d < NumberOfDirections; d++)
+	{
+		if (after[d] != board)
+		{
+			double value = gains[d] + network.evaluate(after[d]);
+			if (!found || value > bestValue)
+			{
+				found = true;
+				best = (Direction)d;
+				bestValue = value;
+			}
+		}
+	}
+	return found;
+}
+
+//-------------------------------------------------------------------------------------
+// The move the network rates best, one move ahead; found is false if none changes
+// the board
+Direction chooseNTupleMove(const NTupleNetwork &network, Bitboard board, bool &found)
+{
+	Bitboard after[NumberOfDirections];
+	int gains[NumberOfDirections];
+	Direction best = DirectionLeft;
+	double value;
+	found = bestMove(network, board, after, gains, best, value);
+	return best;
+}
+
+//-------------------------------------------------------------------------------------
+struct TrainConfig
+{
+	int numberOfGames;
+	int numberOfThreads;
+	double learningRate;
+	uint64_t seed;
+};
+
+//-------------------------------------------------------------------------------------
+// Worker thread: play and learn from every numberOfThreads-th game, starting with
+// game firstGame, recording each game's score and largest tile
+static void trainGames(NTupleNetwork &network, const TrainConfig &config, int firstGame,
+	int numberOfThreads, std::vector<int> &scores, std::vector<int> &maxTiles, int64_t &moves)
+{
+	Game game;
+	moves = 0;
+	for (int g = firstGame; g < config.numberOfGames; g += numberOfThreads)
+	{
+		newGame(game, BitboardSide, config.seed, g);
+		Bitboard previous = 0;     // Board the last move left, before its random piece
+		bool started = false;
+		bool lost = false;
+		Bitboard board;
+		while (packBoard(game.board, board))
+		{
+			Bitboard after[NumberOfDirections];
+			int gains[NumberOfDirections];
+			Direction direction;
+			double value;
+			if (!bestMove(network, board, after, gains, direction, value))
+			{
+				lost = true;
+				break;
+			}
+			if (started)
+			{
+				network.update(previous, config.learningRate * (value - network.evaluate(previous)));
+			}
+			makeMove(game, direction);
+			previous = after[direction];
+			started = true;
+			moves++;
+		}
+		// Nothing more is to come after the last move of a lost game.  A game left
+		// with a tile too large to pack just stops, without that last update.
+		if (started && lost)
+		{
+			network.update(previous, -config.learningRate * network.evaluate(previous));
+		}
+		scores[g] = game.score;
+		maxTiles[g] = maxTileValue(game);
+	}
+}
+
+//-------------------------------------------------------------------------------------
+// Mean of the scores from first to end, and the percent of those games that made a
+// tile of at least goal
+static void summarizeGames(const std::vector<int> &scores, const std::vector<int> &maxTiles,
+	int first, int end, int goal, double &meanScore, double &goalPercent)
+{
+	double total = 0;
+	int reached = 0;
+	for (int g = first; g < end; g++)
+	{
+		total += scores[g];
+		reached += (maxTiles[g] >= goal);
+	}
+	meanScore = total / std::max(1, end - first);
+	goalPercent = 100.0 * reached / std::max(1, end - first);
+}
+
+//-------------------------------------------------------------------------------------
+static void displayTrainUsage()
+{
+	std::cout << "Usage: 1024 --train FILE [--games N] [--threads T] [--rate A] [--seed X]\n";
+}
+
+//-------------------------------------------------------------------------------------
+// Handle "--train FILE" on the command line: train the network in FILE by self-play
+// and save it back.  Returns the program's exit status.
+int runTrainCommand(int argc, char *argv[])
+{
+	if (argc < 3)
+	{
+		displayTrainUsage();
+		return 1;
+	}
+	const char *path = argv[2];
+	TrainConfig config;
+	config.numberOfGames = 10000;
+	config.numberOfThreads = 0;
+	config.learningRate = DefaultLearningRate;
+	config.seed = 1;
+	for (int i = 3; i < argc; i++)
+	{
+		const char *option = argv[i];
+		const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+		if (value == NULL)
+		{
+			displayTrainUsage();
+			return 1;
+		}
+		if (strcmp(option, "--games") == 0) {
+			config.numberOfGames = atoi(value);
+		}
+		else if (strcmp(option, "--threads") == 0) {
+			config.numberOfThreads = atoi(value);
+		}
+		else if (strcmp(option, "--rate") == 0) {
+			config.learningRate = atof(value);
+		}
+		else if (strcmp(option, "--seed") == 0) {
+			config.seed = strtoull(value, NULL, 10);
+		}
+		else {
+			displayTrainUsage();
+			return 1;
+		}
+		i++;   // Skip over the value
+	}
+	if (config.numberOfGames < 1 || config.learningRate <= 0)
+	{
+		displayTrainUsage();
+		return 1;
+	}
+	if (config.numberOfThreads <= 0)
+	{
+		config.numberOfThreads = std::max(1u, std::thread::hardware_concurrency());
+	}
+	config.numberOfThreads = std::min(config.numberOfThreads, config.numberOfGames);
+
+	initializeBitboardTables();
+	NTupleNetwork network;
+	FILE *existing = fopen(path, "rb");
+	if (existing != NULL)
+	{
+		fclose(existing);
+		if (!network.load(path))
+		{
+			std::cout << path << " is not a 1024 n-tuple network." << std::endl;
+			return 1;
+		}
+	}
+
+	std::vector<int> scores(config.numberOfGames, 0);
+	std::vector<int> maxTiles(config.numberOfGames, 0);
+	std::vector<int64_t> moves(config.numberOfThreads, 0);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::vector<std::thread> workers;
+	for (int t = 0; t < config.numberOfThreads; t++)
+	{
+		workers.push_back(std::thread(trainGames, std::ref(network), std::cref(config), t,
+			config.numberOfThreads, std::ref(scores), std::ref(maxTiles), std::ref(moves[t])));
+	}
+	for (size_t t = 0; t < workers.size(); t++)
+	{
+		workers[t].join();
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	bool saved = network.save(path);
+
+	int64_t totalMoves = 0;
+	for (size_t t = 0; t < moves.size(); t++)
+	{
+		totalMoves += moves[t];
+	}
+	int tenth = std::max(1, config.numberOfGames / 10);
+	int goal = goalTileValue(BitboardSide);
+	double firstMean, firstGoal, lastMean, lastGoal;
+	summarizeGames(scores, maxTiles, 0, tenth, goal, firstMean, firstGoal);
+	summarizeGames(scores, maxTiles, config.numberOfGames - tenth, config.numberOfGames, goal, lastMean, lastGoal);
+
+	std::cout << std::fixed << std::setprecision(1)
+		<< "games: " << config.numberOfGames << "\n"
+		<< "threads: " << config.numberOfThreads << "\n"
+		<< "learning_rate: " << std::setprecision(4) << config.learningRate << "\n"
+		<< "seconds: " << std::setprecision(3) << elapsed.count() << "\n"
+		<< std::setprecision(1)
+		<< "moves_per_sec: " << totalMoves / elapsed.count() << "\n"
+		<< "score_mean_first_tenth: " << firstMean << "\n"
+		<< "score_mean_last_tenth: " << lastMean << "\n"
+		<< "goal_" << goal << "_first_tenth: " << firstGoal << "%\n"
+		<< "goal_" << goal << "_last_tenth: " << lastGoal << "%\n";
+	if (!saved)
+	{
+		std::cout << "Unable to save the network to " << path << "." << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,80 @@
+//  ntuple.h
+//     Learned evaluation of packed 4x4 boards: an n-tuple network, with a trainer that
+//     learns its weights from self-play by temporal-difference learning.
+//
+//     The network has one table of weights for each of NumberOfTuples groups of four
+//     squares: the outer row, the second row, and the 2x2 squares in the corner, on
+//     the edge and in the middle.  The four tile exponents of a tuple's squares, a
+//     nibble each, index its table of 65536 weights.  The board is evaluated as seen
+//     through each of its 8 symmetries, so the outer-row table is applied to all four
+//     edges in both directions, and so on; the value is the sum of the 40 weights
+//     looked up, estimating the points still to come from a board just after a move
+//     (before the new piece appears).  The tables are one flat, cache-aligned block.
+//
+//     The trainer plays games on several threads, each move the one that scores best
+//     by the points it makes plus the value of the board after it, with the normal
+//     slide and random piece of makeMove().  After each move, the value of the
+//     previous move's board is pulled toward the points the new move makes plus the
+//     new move's board's value (TD(0) on afterstates).  The threads all update the
+//     one set of weights without locks: each weight is read and written atomically,
+//     and an update that races another may be lost, which the learning shrugs off.
+//
+//     A network file is an NTupleFileHeader, the squares of each tuple, then the
+//     weights as 32-bit floats, table after table, in the machine's byte order.  It
+//     is written to FILE.tmp and renamed over FILE, so a save that fails leaves the
+//     network saved before it as it was.
+//
+//     Started from the command line with:
+//        1024 --train FILE [--games N] [--threads T] [--rate A] [--seed X]
+//     which trains the network in FILE (a new one if FILE does not exist yet) for N
+//     more games and saves it back to FILE.
+
+#ifndef NTUPLE_H
+#define NTUPLE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <vector>
+#include "bitboard.h"
+
+const uint32_t NTupleMagic = 0x4E4B3147;   // "G1KN"
+const uint32_t NTupleVersion = 1;
+const int NumberOfTuples = 5;
+const int TupleSquares = 4;
+const int TupleWeights = 1 << (4 * TupleSquares);   // One per combination of four exponents
+
+struct NTupleFileHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t numberOfTuples;
+	uint32_t tupleSquares;
+};
+
+//-------------------------------------------------------------------------------------
+class NTupleNetwork
+{
+public:
+	NTupleNetwork();
+
+	double evaluate(Bitboard board) const;
+	void update(Bitboard board, double change);
+	bool load(const char *path);
+	bool save(const char *path);
+
+	// Hash of the weights as made, or as last loaded or saved, to tell networks apart
+	uint64_t getFingerprint() const { return fingerprint; }
+
+private:
+	void computeFingerprint();
+
+	std::vector<std::atomic<float> > storage;   // Holds the weights, with room to align them
+	std::atomic<float> *weights;       // Weight w of tuple t at weights[t * TupleWeights + w]
+	uint64_t fingerprint;
+};
+
+Direction chooseNTupleMove(const NTupleNetwork &network, Bitboard board, bool &found);
+int runTrainCommand(int argc, char *argv[]);
+
+#endif // NTUPLE_H
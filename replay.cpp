@@ -0,0 +1,616 @@
+//  replay.cpp
+//     Binary replay files.  See replay.h.
+
+#include "replay.h"
+#include "history.h"
+#include "boardkernels.h"
+#include "bitboard.h"
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char ReplayMagic[4] = { 'G', '1', 'K', 'R' };
+
+
+//-------------------------------------------------------------------------------------
+// Little-endian numbers in a record
+static int32_t getInt32(const uint8_t *bytes)
+{
+	return (int32_t)((uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8)
+		| ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24));
+}
+
+static uint64_t getInt64(const uint8_t *bytes)
+{
+	return (uint64_t)(uint32_t)getInt32(bytes) | ((uint64_t)(uint32_t)getInt32(bytes + 4) << 32);
+}
+
+//-------------------------------------------------------------------------------------
+// Bytes taken by a record starting with the given code, or 0 for an unknown code
+static size_t recordLength(uint8_t code)
+{
+	if (code < ReplaySetPiece) {
+		return 2;
+	}
+	switch (code) {
+	case ReplaySetPiece:
+		return 6;
+	case ReplayUndo:
+	case ReplayRedo:
+	case ReplayStart:
+		return 1;
+	case ReplayJump:
+	case ReplayEnd:
+		return 9;
+	default:
+		return 0;
+	}
+}
+
+
+//-------------------------------------------------------------------------------------
+void ReplayWriter::putInt32(int32_t value)
+{
+	for (int i = 0; i < 4; i++)
+	{
+		buffer.push_back((uint8_t)((uint32_t)value >> (8 * i)));
+	}
+}
+
+void ReplayWriter::putInt64(uint64_t value)
+{
+	for (int i = 0; i < 8; i++)
+	{
+		buffer.push_back((uint8_t)(value >> (8 * i)));
+	}
+}
+
+//-------------------------------------------------------------------------------------
+// Start a game that newGame() has just set up: the header, then its starting pieces
+void ReplayWriter::beginGame(const Game &game)
+{
+	buffer.insert(buffer.end(), ReplayMagic, ReplayMagic + 4);
+	buffer.push_back(ReplayVersion);
+	buffer.push_back((uint8_t)game.squaresPerSide);
+	buffer.push_back(0);
+	buffer.push_back(0);
+	putInt64(game.rng.getSeed());
+	putInt64(game.rng.getGameIndex());
+	for (int i = 0; i < game.squaresPerSide * game.squaresPerSide; i++)
+	{
+		if (game.board[i] != 0)
+		{
+			recordSetPiece(i, game.board[i]);
+		}
+	}
+	buffer.push_back(ReplayStart);
+}
+
+//-------------------------------------------------------------------------------------
+// Record a move that changed the board.  after is the game once the move and its
+// random piece have been made.
+void ReplayWriter::recordMove(Direction direction, const Game &after)
+{
+	uint8_t code = (uint8_t)(ReplayMove | direction);
+	uint8_t square = NoSquare;
+	if (after.lastSpawnSquare >= 0)
+	{
+		square = (uint8_t)after.lastSpawnSquare;
+		if (after.board[after.lastSpawnSquare] == 4)
+		{
+			code |= ReplaySpawnedFour;
+		}
+	}
+	buffer.push_back(code);
+	buffer.push_back(square);
+}
+
+//-------------------------------------------------------------------------------------
+void ReplayWriter::recordSetPiece(int square, int value)
+{
+	buffer.push_back(ReplaySetPiece);
+	buffer.push_back((uint8_t)square);
+	putInt32(value);
+}
+
+//-------------------------------------------------------------------------------------
+void ReplayWriter::recordJump(int line, int moveNumber)
+{
+	buffer.push_back(ReplayJump);
+	putInt32(line);
+	putInt32(moveNumber);
+}
+
+//-------------------------------------------------------------------------------------
+// Finish the game with its final score and move number, and write it out
+void ReplayWriter::endGame(const Game &game)
+{
+	buffer.push_back(ReplayEnd);
+	putInt32(game.score);
+	putInt32(game.moveNumber);
+	flush();
+}
+
+//-------------------------------------------------------------------------------------
+// Append everything recorded so far to the file in one write.  Returns false if the
+// write failed.
+bool ReplayWriter::flush()
+{
+	if (file == NULL)
+	{
+		buffer.clear();   // Not saving: just forget the records
+		return true;
+	}
+	if (buffer.empty())
+	{
+		return true;
+	}
+	bool written = fwrite(&buffer[0], 1, buffer.size(), file) == buffer.size();
+	buffer.clear();
+	return fflush(file) == 0 && written;
+}
+
+
+//-------------------------------------------------------------------------------------
+ReplayReader::ReplayReader()
+{
+	data = NULL;
+	size = 0;
+	position = 0;
+	corrupt = false;
+#ifdef _WIN32
+	fileHandle = INVALID_HANDLE_VALUE;
+	mappingHandle = NULL;
+#endif
+}
+
+//-------------------------------------------------------------------------------------
+// Map the whole file into memory, read-only.  Returns false if it cannot be opened.
+bool ReplayReader::open(const char *path)
+{
+	close();
+#ifdef _WIN32
+	fileHandle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(fileHandle, &fileSize))
+	{
+		close();
+		return false;
+	}
+	size = (size_t)fileSize.QuadPart;
+	if (size > 0)
+	{
+		mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mappingHandle != NULL)
+		{
+			data = (const uint8_t *)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+		}
+		if (data == NULL)
+		{
+			close();
+			return false;
+		}
+	}
+#else
+	int fd = ::open(path, O_RDONLY);
+	if (fd < 0)
+	{
+		return false;
+	}
+	struct stat info;
+	if (fstat(fd, &info) != 0)
+	{
+		::close(fd);
+		return false;
+	}
+	size = (size_t)info.st_size;
+	if (size > 0)
+	{
+		void *mapped = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (mapped == MAP_FAILED)
+		{
+			::close(fd);
+			size = 0;
+			return false;
+		}
+		madvise(mapped, size, MADV_SEQUENTIAL);
+		data = (const uint8_t *)mapped;
+	}
+	::close(fd);   // The mapping stays valid without the descriptor
+#endif
+	return true;
+}
+
+//-------------------------------------------------------------------------------------
+void ReplayReader::close()
+{
+#ifdef _WIN32
+	if (data != NULL)
+	{
+		UnmapViewOfFile(data);
+	}
+	if (mappingHandle != NULL)
+	{
+		CloseHandle(mappingHandle);
+	}
+	if (fileHandle != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(fileHandle);
+	}
+	fileHandle = INVALID_HANDLE_VALUE;
+	mappingHandle = NULL;
+#else
+	if (data != NULL)
+	{
+		munmap((void *)data, size);
+	}
+#endif
+	data = NULL;
+	size = 0;
+	position = 0;
+	corrupt = false;
+}
+
+//-------------------------------------------------------------------------------------
+// Whether a game header of this version starts at offset
+bool ReplayReader::isHeader(size_t offset) const
+{
+	return offset + ReplayHeaderSize <= size && memcmp(data + offset, ReplayMagic, 4) == 0
+		&& data[offset + 4] == ReplayVersion;
+}
+
+//-------------------------------------------------------------------------------------
+// Offset of the first game header at or after from, or the size of the file if
+// there is none
+size_t ReplayReader::findHeader(size_t from) const
+{
+	while (from < size)
+	{
+		const void *found = memchr(data + from, ReplayMagic[0], size - from);
+		if (found == NULL)
+		{
+			break;
+		}
+		from = (size_t)((const uint8_t *)found - data);
+		if (isHeader(from))
+		{
+			return from;
+		}
+		from++;
+	}
+	return size;
+}
+
+//-------------------------------------------------------------------------------------
+// Find the next game of the file, without replaying it.  Returns false at the end of
+// the file.  Anything that is neither a game nor a game cut short is skipped up to
+// the next game header, and then isCorrupt() is true.
+bool ReplayReader::nextGame(ReplayGame &game)
+{
+	if (position < size && !isHeader(position))
+	{
+		corrupt = true;
+		position = findHeader(position);
+	}
+	if (position >= size)
+	{
+		position = size;
+		return false;
+	}
+	const uint8_t *header = data + position;
+	game.squaresPerSide = header[5];
+	game.seed = getInt64(header + 8);
+	game.gameIndex = getInt64(header + 16);
+	game.records = header + ReplayHeaderSize;
+	game.complete = false;
+	game.hasBranches = false;
+
+	// Step over the records to the end of the game.  A game cut short, or broken by a
+	// record that cannot be stepped over, ends where the next game starts.  A header
+	// could only turn up inside a game's records as a piece value, score or move
+	// number of 1380659527 followed by a move to the right, so one is always taken to
+	// start a new game.
+	size_t next = findHeader(position + ReplayHeaderSize);
+	size_t at = position + ReplayHeaderSize;
+	position = next;
+	while (at < next)
+	{
+		uint8_t code = data[at];
+		size_t length = recordLength(code);
+		if (length == 0 || at + length > next)
+		{
+			corrupt = corrupt || length == 0;
+			break;
+		}
+		at += length;
+		if (code == ReplayEnd)
+		{
+			game.complete = true;
+			position = at;
+			break;
+		}
+		if (code == ReplayUndo || code == ReplayRedo || code == ReplayJump)
+		{
+			game.hasBranches = true;
+		}
+	}
+	game.length = (size_t)(data + at - game.records);
+	return true;
+}
+
+
+//-------------------------------------------------------------------------------------
+// Play a recorded game again from the start, checking every record.  Moves are made
+// with the normal slide kernels and the recorded pieces placed after them.  history
+// is only used by games with undo, redo or jump records.  game is left as the game
+// ended, or as it was at the first bad record.  Every move record replayed is added
+// to moves, since with undos and jumps the game's move number does not count them.
+ReplayStatus replayGame(const ReplayGame &replay, Game &game, GameHistory &history, int64_t &moves)
+{
+	int squaresPerSide = replay.squaresPerSide;
+	if (squaresPerSide < MinBoardSize || squaresPerSide > MaxBoardSize)
+	{
+		return ReplayBadRecord;
+	}
+	int squares = squaresPerSide * squaresPerSide;
+	game.squaresPerSide = squaresPerSide;
+	game.score = 0;
+	game.moveNumber = 1;
+	game.lastSpawnSquare = -1;
+	game.maxTile = 0;
+	game.rng.reseed(replay.seed, replay.gameIndex);
+	initializeBoard(game.board, squaresPerSide, 0);
+	game.emptyCells.reset(game.board, squaresPerSide);
+	bool started = false;   // Whether the starting pieces are all on the board
+
+	const uint8_t *record = replay.records;
+	const uint8_t *end = replay.records + replay.length;
+	while (record < end)
+	{
+		uint8_t code = *record;
+		if (code < ReplaySetPiece)
+		{
+			Direction direction = (Direction)(code & 3);
+			int square = record[1];
+			if (!started || !slideBoard(game.board, squaresPerSide, direction, game.score,
+				&game.emptyCells, &game.maxTile))
+			{
+				return ReplayIllegalMove;
+			}
+			game.lastSpawnSquare = -1;
+			if (square != NoSquare)
+			{
+				if (square >= squares || game.board[square] != 0)
+				{
+					return ReplayBadSpawn;
+				}
+				game.board[square] = (code & ReplaySpawnedFour) ? 4 : 2;
+				game.emptyCells.setFilled(square);
+				game.maxTile = std::max(game.maxTile, game.board[square]);
+				game.lastSpawnSquare = square;
+			}
+			game.moveNumber++;
+			moves++;
+			if (replay.hasBranches)
+			{
+				history.recordMove(direction, game);
+			}
+		}
+		else if (code == ReplaySetPiece)
+		{
+			int square = record[1];
+			int value = getInt32(record + 2);
+			if (square >= squares)
+			{
+				return ReplayBadRecord;
+			}
+			setGamePiece(game, square, value);
+			if (started && replay.hasBranches)
+			{
+				history.recordSetPiece(square, value, game);
+			}
+		}
+		else if (code == ReplayStart)
+		{
+			started = true;
+			if (replay.hasBranches)
+			{
+				history.start(game);
+			}
+		}
+		else if (code == ReplayUndo || code == ReplayRedo || code == ReplayJump)
+		{
+			bool done = started;
+			if (done && code == ReplayUndo) {
+				done = history.undo(game);
+			}
+			else if (done && code == ReplayRedo) {
+				done = history.redo(game);
+			}
+			else if (done) {
+				done = history.jumpToMove(getInt32(record + 1), getInt32(record + 5), game);
+			}
+			if (!done)
+			{
+				return ReplayIllegalMove;
+			}
+		}
+		else if (code == ReplayEnd)
+		{
+			if (game.score != getInt32(record + 1) || game.moveNumber != getInt32(record + 5))
+			{
+				return ReplayWrongResult;
+			}
+			return ReplayOk;
+		}
+		else
+		{
+			return ReplayBadRecord;
+		}
+		record += recordLength(code);
+	}
+	return ReplayTruncated;
+}
+
+//-------------------------------------------------------------------------------------
+// Name used for a status in the verify report
+const char *replayStatusName(ReplayStatus status)
+{
+	static const char *Names[NumberOfReplayStatuses] = {
+		"ok", "truncated", "bad_record", "illegal_move", "bad_spawn", "wrong_result"
+	};
+	return Names[status];
+}
+
+
+//-------------------------------------------------------------------------------------
+// Worker thread: replay every numberOfThreads-th game, starting with game firstGame,
+// counting the games with each status and the moves replayed
+static void verifyGames(const std::vector<ReplayGame> &games, int firstGame, int numberOfThreads,
+	std::vector<int64_t> &statusCounts, int64_t &moves)
+{
+	Game game;
+	GameHistory history;
+	statusCounts.assign(NumberOfReplayStatuses, 0);
+	moves = 0;
+	for (size_t g = firstGame; g < games.size(); g += numberOfThreads)
+	{
+		ReplayStatus status = replayGame(games[g], game, history, moves);
+		statusCounts[status]++;
+	}
+}
+
+//-------------------------------------------------------------------------------------
+static void displayVerifyUsage()
+{
+	std::cout << "Usage: 1024 --verify FILE... [--threads T]\n";
+}
+
+//-------------------------------------------------------------------------------------
+// Handle "--verify" on the command line: replay every game of the given files and
+// report how many were good and how fast they were checked.  Returns the program's
+// exit status, 0 only if every game was good.
+int runVerifyCommand(int argc, char *argv[])
+{
+	std::vector<const char *> paths;
+	int numberOfThreads = 0;
+	for (int i = 2; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+			numberOfThreads = atoi(argv[++i]);
+		}
+		else {
+			paths.push_back(argv[i]);
+		}
+	}
+	if (paths.empty())
+	{
+		displayVerifyUsage();
+		return 1;
+	}
+	if (numberOfThreads <= 0)
+	{
+		numberOfThreads = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	initializeBitboardTables();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	// Map every file and find its games, then replay the games on all threads
+	std::vector<ReplayReader *> readers;
+	std::vector<ReplayGame> games;
+	size_t totalBytes = 0;
+	int corruptFiles = 0;
+	for (size_t f = 0; f < paths.size(); f++)
+	{
+		ReplayReader *reader = new ReplayReader;
+		if (!reader->open(paths[f]))
+		{
+			std::cout << "Unable to open " << paths[f] << std::endl;
+			delete reader;
+			corruptFiles++;
+			continue;
+		}
+		readers.push_back(reader);
+		totalBytes += reader->getSize();
+		ReplayGame game;
+		while (reader->nextGame(game))
+		{
+			games.push_back(game);
+		}
+		if (reader->isCorrupt())
+		{
+			corruptFiles++;
+		}
+	}
+
+	numberOfThreads = std::max(1, std::min(numberOfThreads, (int)games.size()));
+	std::vector<std::vector<int64_t> > statusCounts(numberOfThreads);
+	std::vector<int64_t> moves(numberOfThreads, 0);
+	std::vector<std::thread> workers;
+	for (int t = 0; t < numberOfThreads; t++)
+	{
+		workers.push_back(std::thread(verifyGames, std::cref(games), t, numberOfThreads,
+			std::ref(statusCounts[t]), std::ref(moves[t])));
+	}
+	for (size_t t = 0; t < workers.size(); t++)
+	{
+		workers[t].join();
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	for (size_t f = 0; f < readers.size(); f++)
+	{
+		delete readers[f];
+	}
+
+	int64_t totals[NumberOfReplayStatuses] = { 0 };
+	int64_t totalMoves = 0;
+	for (int t = 0; t < numberOfThreads; t++)
+	{
+		for (int s = 0; s < NumberOfReplayStatuses; s++)
+		{
+			totals[s] += statusCounts[t].empty() ? 0 : statusCounts[t][s];
+		}
+		totalMoves += moves[t];
+	}
+
+	double seconds = elapsed.count();
+	std::cout << std::fixed << std::setprecision(1)
+		<< "files: " << paths.size() << "\n"
+		<< "files_corrupt: " << corruptFiles << "\n"
+		<< "games: " << games.size() << "\n";
+	for (int s = 0; s < NumberOfReplayStatuses; s++)
+	{
+		std::cout << "games_" << replayStatusName((ReplayStatus)s) << ": " << totals[s] << "\n";
+	}
+	std::cout << "moves_total: " << totalMoves << "\n"
+		<< "bytes: " << totalBytes << "\n"
+		<< "threads: " << numberOfThreads << "\n"
+		<< "seconds: " << std::setprecision(3) << seconds << "\n"
+		<< std::setprecision(1)
+		<< "mb_per_sec: " << totalBytes / 1e6 / seconds << "\n"
+		<< "games_per_sec: " << games.size() / seconds << "\n"
+		<< "moves_per_sec: " << totalMoves / seconds << "\n";
+
+	return (corruptFiles == 0 && totals[ReplayOk] == (int64_t)games.size()) ? 0 : 1;
+}
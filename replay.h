@@ -0,0 +1,137 @@
+//  replay.h
+//     Binary replay files.  A file holds any number of games one after another, each
+//     a fixed 24-byte header followed by a packed stream of records:
+//
+//        header   "G1KR", version, board size, 2 unused bytes, seed (8), game index (8)
+//        start    1 byte: ReplayStart, after the set records of the starting pieces
+//        move     1 byte: ReplayMove | direction | ReplaySpawnedFour, then 1 byte spawn square
+//        set      1 byte: ReplaySetPiece, then 1 byte square and 4 bytes value
+//        undo     1 byte: ReplayUndo
+//        redo     1 byte: ReplayRedo
+//        jump     1 byte: ReplayJump, then 4 bytes line and 4 bytes move number
+//        end      1 byte: ReplayEnd, then 4 bytes final score and 4 bytes move number
+//
+//     Numbers are little-endian.  The starting pieces are written as set records, so
+//     a game can be replayed without knowing how its random pieces were drawn.  A
+//     typical move takes 2 bytes.
+//
+//     ReplayWriter collects a game's records in memory and appends the whole game
+//     with a single write when it ends, so writers on several threads can share one
+//     file without splitting each other's games, and a game that never ends is never
+//     written.  ReplayReader maps a file into memory and walks its games in place,
+//     and replayGame() re-simulates one with the normal slide kernels, checking every
+//     move and piece along the way.  A game cut short inside a file, as by a write
+//     that never finished, ends at the next game header, so the games after it are
+//     still read.
+//
+//     Bulk verification is started from the command line with:
+//        1024 --verify FILE... [--threads T]
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <vector>
+#include "game.h"
+
+class GameHistory;
+
+const int ReplayHeaderSize = 24;
+const uint8_t ReplayVersion = 1;
+
+// First byte of each record
+enum ReplayCode
+{
+	ReplayMove = 0x00,          // Low 2 bits are the Direction
+	ReplaySpawnedFour = 0x04,   // Added to ReplayMove when the piece placed was a 4 rather than a 2
+	ReplaySetPiece = 0x08,
+	ReplayUndo = 0x09,
+	ReplayRedo = 0x0A,
+	ReplayJump = 0x0B,
+	ReplayStart = 0x0C,
+	ReplayEnd = 0x0F
+};
+
+// What replayGame() found
+enum ReplayStatus
+{
+	ReplayOk,
+	ReplayTruncated,       // The game has no end record
+	ReplayBadRecord,       // Unknown code, or a square or board size out of range
+	ReplayIllegalMove,     // A move, undo, redo or jump that could not have been made
+	ReplayBadSpawn,        // A random piece placed on a square that was not open
+	ReplayWrongResult,     // The final score or move number does not match the end record
+	NumberOfReplayStatuses
+};
+
+//-------------------------------------------------------------------------------------
+class ReplayWriter
+{
+public:
+	explicit ReplayWriter(FILE *file) : file(file) { }
+
+	void beginGame(const Game &game);
+	void recordMove(Direction direction, const Game &after);
+	void recordSetPiece(int square, int value);
+	void recordUndo() { buffer.push_back(ReplayUndo); }
+	void recordRedo() { buffer.push_back(ReplayRedo); }
+	void recordJump(int line, int moveNumber);
+	void endGame(const Game &game);
+
+private:
+	bool flush();
+	void putInt32(int32_t value);
+	void putInt64(uint64_t value);
+
+	FILE *file;
+	std::vector<uint8_t> buffer;   // Records not yet written to the file
+};
+
+//-------------------------------------------------------------------------------------
+// One game of a mapped replay file
+struct ReplayGame
+{
+	int squaresPerSide;
+	uint64_t seed;
+	uint64_t gameIndex;
+	const uint8_t *records;    // Records after the header, up to and including the end record
+	size_t length;
+	bool complete;             // False if the file or the next game starts before the game's end record
+	bool hasBranches;          // Whether the game uses undo, redo or jump
+};
+
+//-------------------------------------------------------------------------------------
+class ReplayReader
+{
+public:
+	ReplayReader();
+	~ReplayReader() { close(); }
+
+	bool open(const char *path);
+	void close();
+	bool nextGame(ReplayGame &game);
+
+	size_t getSize() const { return size; }
+	bool isCorrupt() const { return corrupt; }
+
+private:
+	bool isHeader(size_t offset) const;
+	size_t findHeader(size_t from) const;
+
+	const uint8_t *data;
+	size_t size;
+	size_t position;    // Offset of the next game's header
+	bool corrupt;       // Whether nextGame() skipped something that is neither a game nor the end of one
+#ifdef _WIN32
+	void *fileHandle;
+	void *mappingHandle;
+#endif
+};
+
+ReplayStatus replayGame(const ReplayGame &replay, Game &game, GameHistory &history, int64_t &moves);
+const char *replayStatusName(ReplayStatus status);
+int runVerifyCommand(int argc, char *argv[]);
+
+#endif // REPLAY_H
@@ -0,0 +1,763 @@
+//  sessionserver.cpp
+//     Multi-session game server and its load generator.  See sessionserver.h.
+
+#include "sessionserver.h"
+#include "game.h"
+#include "history.h"
+#include "bitboard.h"
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <algorithm>
+
+#ifdef __linux__
+#include <cerrno>
+#include <csignal>
+#include <climits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#ifndef EPOLLEXCLUSIVE
+#define EPOLLEXCLUSIVE 0     // Kernels before 4.5 wake every loop for a new connection
+#endif
+
+const int MaxEventsPerWait = 256;
+const int MaxCommandLength = 256;   // A session sending a longer line is closed
+const int ReadChunkSize = 4096;
+
+struct ServeOptions
+{
+	const char *socketPath;   // Unix-domain socket to use, or NULL for TCP
+	int port;                 // TCP port on 127.0.0.1, if socketPath is NULL
+	int numberOfThreads;      // 0 means one per core
+	int squaresPerSide;       // Server: board size of new sessions
+	uint64_t seed;            // Server: seed for every session's games
+	int numberOfSessions;     // Load generator: sessions to open
+	int commandsPerSession;   // Load generator: commands to send on each
+};
+
+// One player's connection to the server
+struct Session
+{
+	int fd;
+	int slot;                 // Position in its thread's list of sessions
+	Game game;
+	GameHistory history;
+	std::string input;        // Bytes received that are not yet a whole command
+	std::string output;       // Answers not yet sent
+	bool closing;             // Close once the output is sent, after 'x'
+	bool watchingWrites;      // Whether the loop is waiting for room to send
+};
+
+static std::atomic<bool> stopRequested(false);
+static std::atomic<uint64_t> gamesStarted(0);   // Game index of the next game started on the server
+
+
+//-------------------------------------------------------------------------------------
+static void requestStop(int)
+{
+	stopRequested.store(true);
+}
+
+//-------------------------------------------------------------------------------------
+// Ten thousand sessions need ten thousand file descriptors, more than the usual
+// default, so use as many as the system allows
+static void raiseFileLimit()
+{
+	struct rlimit limit;
+	if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max)
+	{
+		limit.rlim_cur = limit.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &limit);
+	}
+}
+
+//-------------------------------------------------------------------------------------
+static void displayServeUsage()
+{
+	std::cout << "Usage: 1024 --serve [--socket PATH | --port N] [--threads T] [--size S] [--seed X]\n"
+		<< "       1024 --serve-load [--socket PATH | --port N] [--sessions N] [--commands M] [--threads T]\n";
+}
+
+//-------------------------------------------------------------------------------------
+// Read the options of --serve (forServer) or --serve-load.  Returns false, after
+// showing the usage, if they are not valid.
+static bool parseServeOptions(int argc, char *argv[], bool forServer, ServeOptions &options)
+{
+	options.socketPath = NULL;
+	options.port = 7024;
+	options.numberOfThreads = 0;
+	options.squaresPerSide = 4;
+	options.seed = 1;
+	options.numberOfSessions = 1000;
+	options.commandsPerSession = 100;
+
+	for (int i = 2; i < argc; i++)
+	{
+		const char *option = argv[i];
+		const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+		if (value == NULL)
+		{
+			displayServeUsage();
+			return false;
+		}
+		if (strcmp(option, "--socket") == 0) {
+			options.socketPath = value;
+		}
+		else if (strcmp(option, "--port") == 0) {
+			options.port = atoi(value);
+		}
+		else if (strcmp(option, "--threads") == 0) {
+			options.numberOfThreads = atoi(value);
+		}
+		else if (forServer && strcmp(option, "--size") == 0) {
+			options.squaresPerSide = atoi(value);
+		}
+		else if (forServer && strcmp(option, "--seed") == 0) {
+			options.seed = strtoull(value, NULL, 10);
+		}
+		else if (!forServer && strcmp(option, "--sessions") == 0) {
+			options.numberOfSessions = atoi(value);
+		}
+		else if (!forServer && strcmp(option, "--commands") == 0) {
+			options.commandsPerSession = atoi(value);
+		}
+		else {
+			displayServeUsage();
+			return false;
+		}
+		i++;   // Skip over the value
+	}
+
+	if (options.numberOfThreads <= 0)
+	{
+		options.numberOfThreads = std::max(1u, std::thread::hardware_concurrency());
+	}
+	if (options.port <= 0 || options.port > 65535
+		|| options.squaresPerSide < MinBoardSize || options.squaresPerSide > MaxBoardSize
+		|| options.numberOfSessions < 1 || options.commandsPerSession < 1)
+	{
+		displayServeUsage();
+		return false;
+	}
+	return true;
+}
+
+//-------------------------------------------------------------------------------------
+// Socket address for the options.  Returns its length.
+static socklen_t serverAddress(const ServeOptions &options, sockaddr_storage &address)
+{
+	memset(&address, 0, sizeof(address));
+	if (options.socketPath != NULL)
+	{
+		sockaddr_un &local = (sockaddr_un &)address;
+		local.sun_family = AF_UNIX;
+		strncpy(local.sun_path, options.socketPath, sizeof(local.sun_path) - 1);
+		return sizeof(sockaddr_un);
+	}
+	sockaddr_in &inet = (sockaddr_in &)address;
+	inet.sin_family = AF_INET;
+	inet.sin_port = htons((uint16_t)options.port);
+	inet.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	return sizeof(sockaddr_in);
+}
+
+//-------------------------------------------------------------------------------------
+// Commands are a few bytes each and every one waits for its answer, so TCP must send
+// them at once rather than hold them back to fill a packet
+static void sendImmediately(int fd, const ServeOptions &options)
+{
+	if (options.socketPath == NULL)
+	{
+		int on = 1;
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+	}
+}
+
+//-------------------------------------------------------------------------------------
+// Append a number to an answer
+static void appendNumber(std::string &text, int value)
+{
+	char digits[12];
+	int count = 0;
+	unsigned int magnitude = value < 0 ? 0u - (unsigned int)value : (unsigned int)value;
+	do
+	{
+		digits[count++] = (char)('0' + magnitude % 10);
+		magnitude /= 10;
+	} while (magnitude != 0);
+	if (value < 0)
+	{
+		text += '-';
+	}
+	while (count > 0)
+	{
+		text += digits[--count];
+	}
+}
+
+//-------------------------------------------------------------------------------------
+static void startSessionGame(Session &session, int squaresPerSide, uint64_t seed)
+{
+	newGame(session.game, squaresPerSide, seed, gamesStarted.fetch_add(1, std::memory_order_relaxed));
+	session.history.start(session.game);
+}
+
+//-------------------------------------------------------------------------------------
+// Carry out one command line and append its answer to the session's output, the way
+// the console game's switch (userInput) does
+static void handleCommand(Session &session, const char *line, const ServeOptions &options)
+{
+	Game &game = session.game;
+	while (*line == ' ')
+	{
+		line++;
+	}
+	char command = *line;
+	const char *arguments = (command != '\0') ? line + 1 : line;
+	const char *status = "ok";
+	char *end;
+
+	switch (command) {
+	case 'x':
+		session.output += "bye\n";
+		session.closing = true;
+		return;
+	case 'p':
+		{
+			long index = strtol(arguments, &end, 10);
+			const char *valueText = end;
+			long value = strtol(valueText, &end, 10);
+			if (valueText == arguments || end == valueText
+				|| index < 0 || index >= game.squaresPerSide * game.squaresPerSide
+				|| value < INT_MIN || value > INT_MAX)   // A value cut down to an int would be recorded wrong
+			{
+				status = "bad";
+				break;
+			}
+			setGamePiece(game, (int)index, (int)value);
+			session.history.recordSetPiece((int)index, (int)value, game);
+		}
+		break;
+	case 'r':
+		{
+			long size = strtol(arguments, &end, 10);
+			if (end == arguments)
+			{
+				size = game.squaresPerSide;
+			}
+			if (size < MinBoardSize || size > MaxBoardSize)
+			{
+				status = "bad";
+				break;
+			}
+			startSessionGame(session, (int)size, options.seed);
+		}
+		break;
+	case 'u':
+		if (!session.history.undo(game))
+		{
+			status = "no";
+		}
+		break;
+	case 'a':
+	case 'd':
+	case 'w':
+	case 's':
+		{
+			Direction direction = (command == 'a') ? DirectionLeft : (command == 'd') ? DirectionRight
+				: (command == 'w') ? DirectionUp : DirectionDown;
+			if (makeMove(game, direction))
+			{
+				session.history.recordMove(direction, game);
+			}
+			else
+			{
+				status = "no";
+			}
+		}
+		break;
+	default:
+		status = "bad";
+		break;
+	}
+	if (status[0] != 'b' && !hasLegalMove(game))
+	{
+		status = "over";
+	}
+
+	session.output += status;
+	session.output += ' ';
+	appendNumber(session.output, game.score);
+	session.output += ' ';
+	appendNumber(session.output, game.moveNumber);
+	for (int i = 0; i < game.squaresPerSide * game.squaresPerSide; i++)
+	{
+		session.output += ' ';
+		appendNumber(session.output, game.board[i]);
+	}
+	session.output += '\n';
+}
+
+//-------------------------------------------------------------------------------------
+// Read what the session has sent and carry out every whole command in it.  Returns
+// false if the session should be closed.
+static bool readCommands(Session &session, const ServeOptions &options, int64_t &commands)
+{
+	char buffer[ReadChunkSize];
+	ssize_t received = recv(session.fd, buffer, sizeof(buffer), 0);
+	if (received == 0)
+	{
+		return false;
+	}
+	if (received < 0)
+	{
+		return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+	}
+	session.input.append(buffer, received);
+
+	size_t start = 0;
+	size_t end;
+	while (!session.closing && (end = session.input.find('\n', start)) != std::string::npos)
+	{
+		session.input[end] = '\0';
+		if (end > start && session.input[end - 1] == '\r')
+		{
+			session.input[end - 1] = '\0';
+		}
+		handleCommand(session, &session.input[start], options);
+		commands++;
+		start = end + 1;
+	}
+	session.input.erase(0, start);
+	return session.input.size() <= (size_t)MaxCommandLength;
+}
+
+//-------------------------------------------------------------------------------------
+// Send as much of the session's output as the socket takes.  Returns false if the
+// session should be closed.
+static bool writeAnswers(Session &session)
+{
+	size_t sent = 0;
+	while (sent < session.output.size())
+	{
+		ssize_t count = send(session.fd, session.output.data() + sent, session.output.size() - sent, MSG_NOSIGNAL);
+		if (count > 0)
+		{
+			sent += count;
+		}
+		else if (count < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		else
+		{
+			session.output.erase(0, sent);
+			return count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+		}
+	}
+	session.output.clear();
+	return !session.closing;
+}
+
+//-------------------------------------------------------------------------------------
+static void closeSession(int epollFd, std::vector<Session *> &sessions, Session *session)
+{
+	epoll_ctl(epollFd, EPOLL_CTL_DEL, session->fd, NULL);
+	close(session->fd);
+	sessions[session->slot] = sessions.back();
+	sessions[session->slot]->slot = session->slot;
+	sessions.pop_back();
+	delete session;
+}
+
+//-------------------------------------------------------------------------------------
+// Server thread: one event loop, taking new connections from the shared listening
+// socket and serving the sessions it took until the server is stopped
+static void serveSessions(int listenFd, const ServeOptions &options, int64_t &sessionsOpened, int64_t &commands)
+{
+	int epollFd = epoll_create1(EPOLL_CLOEXEC);
+	epoll_event event;
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN | EPOLLEXCLUSIVE;
+	event.data.ptr = NULL;   // The listening socket
+	epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &event);
+
+	std::vector<Session *> sessions;
+	epoll_event events[MaxEventsPerWait];
+	sessionsOpened = 0;
+	commands = 0;
+	while (!stopRequested.load())
+	{
+		// Wake up now and then to see whether the server has been stopped
+		int count = epoll_wait(epollFd, events, MaxEventsPerWait, 100);
+		for (int e = 0; e < count; e++)
+		{
+			Session *session = (Session *)events[e].data.ptr;
+			if (session == NULL)
+			{
+				int fd;
+				while ((fd = accept4(listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0)
+				{
+					sendImmediately(fd, options);
+					session = new Session;
+					session->fd = fd;
+					session->slot = (int)sessions.size();
+					session->closing = false;
+					session->watchingWrites = false;
+					startSessionGame(*session, options.squaresPerSide, options.seed);
+					sessions.push_back(session);
+					event.events = EPOLLIN;
+					event.data.ptr = session;
+					epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+					sessionsOpened++;
+				}
+				continue;
+			}
+
+			// After 'x' the session is closed as soon as its last answer is sent
+			bool keep = true;
+			if (events[e].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+			{
+				keep = readCommands(*session, options, commands);
+			}
+			if (keep)
+			{
+				keep = writeAnswers(*session);
+			}
+			if (!keep)
+			{
+				closeSession(epollFd, sessions, session);
+				continue;
+			}
+
+			// Only wait for room to send while there is something left to send
+			bool wantsWrites = !session->output.empty();
+			if (wantsWrites != session->watchingWrites)
+			{
+				event.events = wantsWrites ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+				event.data.ptr = session;
+				epoll_ctl(epollFd, EPOLL_CTL_MOD, session->fd, &event);
+				session->watchingWrites = wantsWrites;
+			}
+		}
+	}
+
+	while (!sessions.empty())
+	{
+		closeSession(epollFd, sessions, sessions.back());
+	}
+	close(epollFd);
+}
+
+//-------------------------------------------------------------------------------------
+// Handle "--serve" on the command line: serve sessions until stopped with Ctrl-C or
+// a TERM signal.  Returns the program's exit status.
+int runServeCommand(int argc, char *argv[])
+{
+	ServeOptions options;
+	if (!parseServeOptions(argc, argv, true, options))
+	{
+		return 1;
+	}
+	raiseFileLimit();
+	initializeBitboardTables();
+
+	sockaddr_storage address;
+	socklen_t addressLength = serverAddress(options, address);
+	int listenFd = socket(address.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	int on = 1;
+	setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+	if (options.socketPath != NULL)
+	{
+		unlink(options.socketPath);
+	}
+	if (listenFd < 0 || bind(listenFd, (sockaddr *)&address, addressLength) != 0 || listen(listenFd, SOMAXCONN) != 0)
+	{
+		std::cout << "Unable to listen on " << (options.socketPath != NULL ? options.socketPath : "that port")
+			<< ": " << strerror(errno) << std::endl;
+		return 1;
+	}
+
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = requestStop;
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+
+	if (options.socketPath != NULL)
+	{
+		std::cout << "Serving on " << options.socketPath;
+	}
+	else
+	{
+		std::cout << "Serving on 127.0.0.1:" << options.port;
+	}
+	std::cout << " with " << options.numberOfThreads << " threads" << std::endl;
+
+	std::vector<int64_t> sessionsOpened(options.numberOfThreads, 0), commands(options.numberOfThreads, 0);
+	std::vector<std::thread> workers;
+	for (int t = 0; t < options.numberOfThreads; t++)
+	{
+		workers.push_back(std::thread(serveSessions, listenFd, std::cref(options),
+			std::ref(sessionsOpened[t]), std::ref(commands[t])));
+	}
+	int64_t totalSessions = 0;
+	int64_t totalCommands = 0;
+	for (int t = 0; t < options.numberOfThreads; t++)
+	{
+		workers[t].join();
+		totalSessions += sessionsOpened[t];
+		totalCommands += commands[t];
+	}
+	close(listenFd);
+	if (options.socketPath != NULL)
+	{
+		unlink(options.socketPath);
+	}
+
+	std::cout << "sessions_served: " << totalSessions << "\n"
+		<< "commands_served: " << totalCommands << "\n";
+	return 0;
+}
+
+//-------------------------------------------------------------------------------------
+// One session of the load generator
+struct LoadSession
+{
+	int fd;
+	int commandsLeft;
+	bool lastWasOver;                            // Whether the last answer said the game was over
+	std::string input;                           // Part of an answer received so far
+	std::chrono::steady_clock::time_point sent;  // When the command being answered was sent
+};
+
+//-------------------------------------------------------------------------------------
+// Send the session's next command: a new game if the last one is over, otherwise
+// mostly random moves with the odd undo, and finally 'x'
+static bool sendNextCommand(LoadSession &session, GameRng &rng)
+{
+	static const char *const Moves[NumberOfDirections] = { "a\n", "d\n", "w\n", "s\n" };
+	const char *command;
+	if (session.commandsLeft == 0) {
+		command = "x\n";
+	}
+	else if (session.lastWasOver) {
+		command = "r\n";
+	}
+	else if (rng.nextBelow(16) == 0) {
+		command = "u\n";
+	}
+	else {
+		command = Moves[rng.nextBelow(NumberOfDirections)];
+	}
+	session.sent = std::chrono::steady_clock::now();
+	size_t length = strlen(command);
+	return send(session.fd, command, length, MSG_NOSIGNAL) == (ssize_t)length;
+}
+
+//-------------------------------------------------------------------------------------
+// Load generator thread: open its sessions and keep one command in flight on each
+// until every session has sent all its commands.  Each answer's latency, in
+// microseconds, goes into latencies.
+static void runLoadSessions(const ServeOptions &options, int firstSession, int numberOfSessions,
+	std::vector<float> &latencies, int64_t &errors)
+{
+	GameRng rng(1, firstSession);
+	int epollFd = epoll_create1(EPOLL_CLOEXEC);
+	std::vector<LoadSession> sessions(numberOfSessions);
+	int open = 0;
+	errors = 0;
+	latencies.reserve((size_t)numberOfSessions * (options.commandsPerSession + 1));
+
+	sockaddr_storage address;
+	socklen_t addressLength = serverAddress(options, address);
+	for (int s = 0; s < numberOfSessions; s++)
+	{
+		LoadSession &session = sessions[s];
+		session.fd = socket(address.ss_family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		session.commandsLeft = options.commandsPerSession;
+		session.lastWasOver = false;
+		if (session.fd < 0 || connect(session.fd, (sockaddr *)&address, addressLength) != 0)
+		{
+			if (session.fd >= 0)
+			{
+				close(session.fd);
+			}
+			session.fd = -1;
+			errors++;
+			continue;
+		}
+		sendImmediately(session.fd, options);
+		fcntl(session.fd, F_SETFL, fcntl(session.fd, F_GETFL) | O_NONBLOCK);
+		epoll_event event;
+		memset(&event, 0, sizeof(event));
+		event.events = EPOLLIN;
+		event.data.ptr = &session;
+		epoll_ctl(epollFd, EPOLL_CTL_ADD, session.fd, &event);
+		open++;
+	}
+
+	for (int s = 0; s < numberOfSessions; s++)
+	{
+		if (sessions[s].fd >= 0 && !sendNextCommand(sessions[s], rng))
+		{
+			errors++;
+		}
+	}
+
+	epoll_event events[MaxEventsPerWait];
+	char buffer[ReadChunkSize];
+	while (open > 0)
+	{
+		// A server that has gone quiet for seconds is not coming back
+		int count = epoll_wait(epollFd, events, MaxEventsPerWait, 5000);
+		if (count == 0)
+		{
+			errors += open;
+			break;
+		}
+		for (int e = 0; e < count; e++)
+		{
+			LoadSession &session = *(LoadSession *)events[e].data.ptr;
+			ssize_t received = recv(session.fd, buffer, sizeof(buffer), 0);
+			if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+			{
+				continue;
+			}
+			bool finished = (received <= 0);
+			if (received > 0)
+			{
+				session.input.append(buffer, received);
+			}
+
+			size_t end;
+			while (!finished && (end = session.input.find('\n')) != std::string::npos)
+			{
+				std::chrono::duration<float, std::micro> latency = std::chrono::steady_clock::now() - session.sent;
+				latencies.push_back(latency.count());
+				if (session.input.compare(0, 3, "bye") == 0)
+				{
+					finished = true;
+					break;
+				}
+				if (session.input.compare(0, 3, "bad") == 0)
+				{
+					errors++;
+				}
+				session.lastWasOver = (session.input.compare(0, 4, "over") == 0);
+				session.input.erase(0, end + 1);
+				session.commandsLeft--;
+				if (!sendNextCommand(session, rng))
+				{
+					errors++;
+					finished = true;
+				}
+			}
+			if (finished)
+			{
+				if (session.commandsLeft != 0)
+				{
+					errors++;
+				}
+				epoll_ctl(epollFd, EPOLL_CTL_DEL, session.fd, NULL);
+				close(session.fd);
+				open--;
+			}
+		}
+	}
+	close(epollFd);
+}
+
+//-------------------------------------------------------------------------------------
+// Value at fraction p (0 to 1) of the way through a sorted list
+static float percentile(const std::vector<float> &sorted, double p)
+{
+	return sorted[(size_t)(p * (sorted.size() - 1) + 0.5)];
+}
+
+//-------------------------------------------------------------------------------------
+// Handle "--serve-load" on the command line.  Returns the program's exit status.
+int runServeLoadCommand(int argc, char *argv[])
+{
+	ServeOptions options;
+	if (!parseServeOptions(argc, argv, false, options))
+	{
+		return 1;
+	}
+	raiseFileLimit();
+	int numberOfThreads = std::min(options.numberOfThreads, options.numberOfSessions);
+
+	std::vector<std::vector<float> > latencies(numberOfThreads);
+	std::vector<int64_t> errors(numberOfThreads, 0);
+	std::vector<std::thread> workers;
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	int firstSession = 0;
+	for (int t = 0; t < numberOfThreads; t++)
+	{
+		int sessions = options.numberOfSessions / numberOfThreads + (t < options.numberOfSessions % numberOfThreads ? 1 : 0);
+		workers.push_back(std::thread(runLoadSessions, std::cref(options), firstSession, sessions,
+			std::ref(latencies[t]), std::ref(errors[t])));
+		firstSession += sessions;
+	}
+	std::vector<float> all;
+	int64_t totalErrors = 0;
+	for (int t = 0; t < numberOfThreads; t++)
+	{
+		workers[t].join();
+		all.insert(all.end(), latencies[t].begin(), latencies[t].end());
+		totalErrors += errors[t];
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	if (all.empty())
+	{
+		std::cout << "No answers from the server." << std::endl;
+		return 1;
+	}
+
+	std::sort(all.begin(), all.end());
+	std::cout << std::fixed << std::setprecision(1)
+		<< "sessions: " << options.numberOfSessions << "\n"
+		<< "threads: " << numberOfThreads << "\n"
+		<< "commands: " << all.size() << "\n"
+		<< "seconds: " << std::setprecision(3) << elapsed.count() << "\n"
+		<< std::setprecision(1)
+		<< "commands_per_sec: " << all.size() / elapsed.count() << "\n"
+		<< "latency_us_p50: " << percentile(all, 0.50) << "\n"
+		<< "latency_us_p90: " << percentile(all, 0.90) << "\n"
+		<< "latency_us_p99: " << percentile(all, 0.99) << "\n"
+		<< "latency_us_max: " << all.back() << "\n"
+		<< "errors: " << totalErrors << "\n";
+	return totalErrors == 0 ? 0 : 1;
+}
+
+#else
+
+//-------------------------------------------------------------------------------------
+// The server is built on epoll, which only Linux has
+int runServeCommand(int argc, char *argv[])
+{
+	std::cout << "The session server needs Linux." << std::endl;
+	return 1;
+}
+
+int runServeLoadCommand(int argc, char *argv[])
+{
+	std::cout << "The session server needs Linux." << std::endl;
+	return 1;
+}
+
+#endif
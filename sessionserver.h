@@ -0,0 +1,36 @@
+//  sessionserver.h
+//     Game server for many players at once.  Every connection to the server is an
+//     independent session with its own game, score and undo history, driven by the
+//     same one-letter commands as the console game:
+//
+//        w a s d     move up, left, down, right
+//        u           undo the last move
+//        r [S]       start a new game, on an S x S board if S is given
+//        p I V       set square I to value V
+//        x           end the session
+//
+//     Each command is one line, and the server answers each with one line:
+//        STATUS SCORE MOVE BOARD...
+//     where STATUS is ok, no (the move or undo did nothing), over (no move is left
+//     to make) or bad (not a command), MOVE is the move number and BOARD is the
+//     squares, row by row.  'x' is answered with "bye" before the session closes.
+//
+//     The server runs one epoll event loop per thread, each waiting on the shared
+//     listening socket and on the sessions it accepted, all non-blocking, so a
+//     thread handles whichever of its sessions have commands ready and never waits
+//     on any one of them.
+//
+//     Started from the command line with:
+//        1024 --serve [--socket PATH | --port N] [--threads T] [--size S] [--seed X]
+//        1024 --serve-load [--socket PATH | --port N] [--sessions N] [--commands M] [--threads T]
+//     The second opens N sessions to a running server, sends M random commands on
+//     each, one at a time, and reports the latency of each command from sending it
+//     to receiving its answer.  With --port the server listens on 127.0.0.1.
+
+#ifndef SESSIONSERVER_H
+#define SESSIONSERVER_H
+
+int runServeCommand(int argc, char *argv[]);
+int runServeLoadCommand(int argc, char *argv[]);
+
+#endif // SESSIONSERVER_H
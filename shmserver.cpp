@@ -0,0 +1,500 @@
+//  shmserver.cpp
+//     Shared-memory environment server and its stand-in client.  See shmserver.h.
+
+#include "shmserver.h"
+#include "game.h"
+#include "bitboard.h"
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <new>
+#include <csignal>
+#include <cerrno>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+const int SpinsBeforeYield = 2000;   // Empty polls before a waiting side gives up its core
+const int YieldsBeforeSleep = 10000; // Empty polls after that before it sleeps between polls
+const int IdleSleepMicros = 200;     // Sleep between polls once idle that long
+
+static std::atomic<bool> stopRequested(false);   // Set by an INT or TERM signal
+
+
+//-------------------------------------------------------------------------------------
+// Called each time a poll finds nothing to do.  Spins first, since a reply is often
+// only microseconds away, and only then starts giving the core to other threads.
+static void waitForWork(int &idlePolls)
+{
+	if (++idlePolls > SpinsBeforeYield)
+	{
+		std::this_thread::yield();
+	}
+}
+
+//-------------------------------------------------------------------------------------
+// Called each time a server thread finds no requests.  Waits as waitForWork() does,
+// but once idle for longer, as with no client or one that has died, it sleeps between
+// polls rather than keep a core busy.  Only the server sleeps: the client waits for a
+// reply it knows is coming, and a sleeping client would slow every step.
+static void waitForRequests(int &idlePolls)
+{
+	if (idlePolls > SpinsBeforeYield + YieldsBeforeSleep)
+	{
+		std::this_thread::sleep_for(std::chrono::microseconds(IdleSleepMicros));
+	}
+	else
+	{
+		waitForWork(idlePolls);
+	}
+}
+
+#ifndef _WIN32
+
+//-------------------------------------------------------------------------------------
+static void requestStop(int)
+{
+	stopRequested.store(true);
+}
+
+//-------------------------------------------------------------------------------------
+// Whether the server should stop: asked by the client or by a signal
+static bool stopping(const ShmHeader *header)
+{
+	return header->stopServer.load(std::memory_order_acquire) != 0 || stopRequested.load();
+}
+
+//-------------------------------------------------------------------------------------
+static ShmChannel &channel(void *region, int k)
+{
+	return *(ShmChannel *)((char *)region + shmChannelOffset(k));
+}
+
+//-------------------------------------------------------------------------------------
+// Fill in the observation of a game
+static void observe(const Game &game, uint64_t sequence, int reward, bool moved, ShmObservation &observation)
+{
+	observation.sequence = sequence;
+	observation.reward = reward;
+	observation.score = game.score;
+	observation.moveNumber = game.moveNumber;
+	observation.moved = moved ? 1 : 0;
+	observation.done = hasLegalMove(game) ? 0 : 1;
+	observation.unused[0] = observation.unused[1] = 0;
+	memcpy(observation.board, game.board, game.squaresPerSide * game.squaresPerSide * sizeof(int32_t));
+}
+
+//-------------------------------------------------------------------------------------
+// Server thread: answer the requests of every numberOfThreads-th environment,
+// starting with firstEnvironment, until the client or a signal stops the server
+static void serveEnvironments(void *region, int firstEnvironment, int numberOfThreads,
+	int squaresPerSide, uint64_t seed)
+{
+	ShmHeader *header = (ShmHeader *)region;
+	int numberOfEnvironments = (int)header->numberOfEnvironments;
+
+	// Game and count of games started of each environment served, in the order served
+	int served = (numberOfEnvironments - firstEnvironment + numberOfThreads - 1) / numberOfThreads;
+	std::vector<Game> games(served);
+	std::vector<uint64_t> gamesStarted(games.size(), 0);
+	ShmObservation observation;
+
+	int idlePolls = 0;
+	while (!stopping(header))
+	{
+		bool busy = false;
+		for (int k = firstEnvironment, slot = 0; k < numberOfEnvironments; k += numberOfThreads, slot++)
+		{
+			ShmChannel &ring = channel(region, k);
+			ShmRequest request;
+			while (ring.requests.pop(request))
+			{
+				Game &game = games[slot];
+				int reward = 0;
+				bool moved = false;
+				if (request.kind == ShmReset || gamesStarted[slot] == 0)
+				{
+					// Environment k's n-th game is game n * K + k of the seed
+					newGame(game, squaresPerSide, seed, gamesStarted[slot]++ * numberOfEnvironments + k);
+				}
+				if (request.kind == ShmStep && request.action < (uint32_t)NumberOfDirections)
+				{
+					int oldScore = game.score;
+					moved = makeMove(game, (Direction)request.action);
+					reward = game.score - oldScore;
+				}
+				observe(game, request.sequence, reward, moved, observation);
+
+				// The client pushes no more requests than it has room for observations,
+				// so this only waits if it is slow to read them
+				while (!ring.observations.push(observation) && !stopping(header))
+				{
+					std::this_thread::yield();
+				}
+				busy = true;
+			}
+		}
+		if (busy)
+		{
+			idlePolls = 0;
+		}
+		else
+		{
+			waitForRequests(idlePolls);
+		}
+	}
+}
+
+//-------------------------------------------------------------------------------------
+// Remove a region of the given name if the server that made it is no longer running,
+// as after it was killed without a chance to clean up.  Returns true if removed.
+static bool removeStaleRegion(const std::string &name)
+{
+	int fd = shm_open(name.c_str(), O_RDONLY, 0);
+	if (fd < 0)
+	{
+		return false;
+	}
+	struct stat status;
+	bool stale = false;
+	if (fstat(fd, &status) == 0 && (size_t)status.st_size >= sizeof(ShmHeader))
+	{
+		void *region = mmap(NULL, sizeof(ShmHeader), PROT_READ, MAP_SHARED, fd, 0);
+		if (region != MAP_FAILED)
+		{
+			const ShmHeader *header = (const ShmHeader *)region;
+			stale = header->magic == ShmMagic && header->version == ShmVersion
+				&& kill((pid_t)header->serverProcess, 0) != 0 && errno == ESRCH;
+			munmap(region, sizeof(ShmHeader));
+		}
+	}
+	close(fd);
+	return stale && shm_unlink(name.c_str()) == 0;
+}
+
+//-------------------------------------------------------------------------------------
+static void displayShmServerUsage()
+{
+	std::cout << "Usage: 1024 --shm-server NAME [--environments K] [--size S] [--seed X] [--threads T]\n";
+}
+
+//-------------------------------------------------------------------------------------
+// Handle "--shm-server NAME" on the command line: create the region, serve it until
+// the client or a signal stops the server, and remove it.  Returns the program's
+// exit status.
+int runShmServerCommand(int argc, char *argv[])
+{
+	if (argc < 3)
+	{
+		displayShmServerUsage();
+		return 1;
+	}
+	std::string name = std::string("/") + argv[2];
+	int numberOfEnvironments = 16;
+	int squaresPerSide = 4;
+	uint64_t seed = 1;
+	int numberOfThreads = 1;
+	for (int i = 3; i < argc; i++)
+	{
+		const char *option = argv[i];
+		const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+		if (value == NULL)
+		{
+			displayShmServerUsage();
+			return 1;
+		}
+		if (strcmp(option, "--environments") == 0) {
+			numberOfEnvironments = atoi(value);
+		}
+		else if (strcmp(option, "--size") == 0) {
+			squaresPerSide = atoi(value);
+		}
+		else if (strcmp(option, "--seed") == 0) {
+			seed = strtoull(value, NULL, 10);
+		}
+		else if (strcmp(option, "--threads") == 0) {
+			numberOfThreads = atoi(value);
+		}
+		else {
+			displayShmServerUsage();
+			return 1;
+		}
+		i++;   // Skip over the value
+	}
+	if (numberOfEnvironments < 1 || numberOfThreads < 1
+		|| squaresPerSide < MinBoardSize || squaresPerSide > MaxBoardSize)
+	{
+		displayShmServerUsage();
+		return 1;
+	}
+	numberOfThreads = std::min(numberOfThreads, numberOfEnvironments);
+
+	size_t size = shmRegionSize(numberOfEnvironments);
+	int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+	if (fd < 0 && errno == EEXIST && removeStaleRegion(name))
+	{
+		std::cout << "Removed " << name << ", left behind by a server that is no longer running." << std::endl;
+		fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+	}
+	if (fd < 0)
+	{
+		std::cout << "Unable to create shared memory " << name << ": " << strerror(errno) << "." << std::endl;
+		if (errno == EEXIST)
+		{
+			std::cout << "If no server is using it, remove /dev/shm" << name << "." << std::endl;
+		}
+		return 1;
+	}
+	void *region = MAP_FAILED;
+	if (ftruncate(fd, (off_t)size) == 0)
+	{
+		region = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	}
+	close(fd);
+	if (region == MAP_FAILED)
+	{
+		std::cout << "Unable to map shared memory " << name << "." << std::endl;
+		shm_unlink(name.c_str());
+		return 1;
+	}
+
+	initializeBitboardTables();
+	ShmHeader *header = new (region) ShmHeader;
+	header->magic = ShmMagic;
+	header->version = ShmVersion;
+	header->numberOfEnvironments = numberOfEnvironments;
+	header->squaresPerSide = squaresPerSide;
+	header->serverProcess = (int32_t)getpid();
+	header->stopServer.store(0, std::memory_order_relaxed);
+	for (int k = 0; k < numberOfEnvironments; k++)
+	{
+		ShmChannel *ring = new (&channel(region, k)) ShmChannel;
+		ring->requests.clear();
+		ring->observations.clear();
+	}
+	struct sigaction action;
+	memset(&action, 0, sizeof(action));
+	action.sa_handler = requestStop;
+	sigaction(SIGINT, &action, NULL);
+	sigaction(SIGTERM, &action, NULL);
+
+	header->serverReady.store(1, std::memory_order_release);
+	std::cout << "Serving " << numberOfEnvironments << " environments on " << name << std::endl;
+
+	std::vector<std::thread> workers;
+	for (int t = 0; t < numberOfThreads; t++)
+	{
+		workers.push_back(std::thread(serveEnvironments, region, t, numberOfThreads, squaresPerSide, seed));
+	}
+	for (size_t t = 0; t < workers.size(); t++)
+	{
+		workers[t].join();
+	}
+
+	munmap(region, size);
+	shm_unlink(name.c_str());
+	return 0;
+}
+
+//-------------------------------------------------------------------------------------
+// Value at fraction p (0 to 1) of the way through a sorted list
+static double percentile(const std::vector<double> &sorted, double p)
+{
+	return sorted[(size_t)(p * (sorted.size() - 1) + 0.5)];
+}
+
+//-------------------------------------------------------------------------------------
+// Whether more than ShmClientTimeoutMillis have passed since start
+static bool timedOut(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::steady_clock::now() - start > std::chrono::milliseconds(ShmClientTimeoutMillis);
+}
+
+//-------------------------------------------------------------------------------------
+static void displayShmClientUsage()
+{
+	std::cout << "Usage: 1024 --shm-client NAME [--steps N]\n";
+}
+
+//-------------------------------------------------------------------------------------
+// Handle "--shm-client NAME" on the command line: play random moves in every
+// environment of a running server, one step at a time, timing each step from
+// pushing the request to popping its observation.  Then stop the server.
+int runShmClientCommand(int argc, char *argv[])
+{
+	if (argc < 3)
+	{
+		displayShmClientUsage();
+		return 1;
+	}
+	std::string name = std::string("/") + argv[2];
+	int64_t steps = 100000;
+	for (int i = 3; i < argc; i++)
+	{
+		const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+		if (value == NULL || strcmp(argv[i], "--steps") != 0)
+		{
+			displayShmClientUsage();
+			return 1;
+		}
+		steps = atoll(value);
+		i++;   // Skip over the value
+	}
+	if (steps < 1)
+	{
+		displayShmClientUsage();
+		return 1;
+	}
+
+	// The server may still be starting up
+	int fd = -1;
+	for (int attempt = 0; attempt < 500 && fd < 0; attempt++)
+	{
+		fd = shm_open(name.c_str(), O_RDWR, 0);
+		if (fd < 0)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		}
+	}
+	struct stat status;
+	if (fd < 0 || fstat(fd, &status) != 0 || (size_t)status.st_size < sizeof(ShmHeader))
+	{
+		std::cout << "Unable to open shared memory " << name << "." << std::endl;
+		if (fd >= 0)
+		{
+			close(fd);
+		}
+		return 1;
+	}
+	size_t size = (size_t)status.st_size;
+	void *region = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (region == MAP_FAILED)
+	{
+		std::cout << "Unable to map shared memory " << name << "." << std::endl;
+		return 1;
+	}
+	ShmHeader *header = (ShmHeader *)region;
+	std::chrono::steady_clock::time_point opened = std::chrono::steady_clock::now();
+	while (header->serverReady.load(std::memory_order_acquire) == 0)
+	{
+		if (timedOut(opened))
+		{
+			std::cout << "The server on " << name << " never became ready." << std::endl;
+			munmap(region, size);
+			return 1;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	int numberOfEnvironments = (int)header->numberOfEnvironments;
+	if (header->magic != ShmMagic || header->version != ShmVersion
+		|| size < shmRegionSize(numberOfEnvironments))
+	{
+		std::cout << name << " is not a 1024 environment server." << std::endl;
+		munmap(region, size);
+		return 1;
+	}
+
+	GameRng rng(1, 0);
+	std::vector<double> latencies;
+	latencies.reserve((size_t)steps);
+	int64_t gamesFinished = 0;
+	int64_t totalScore = 0;
+	std::vector<bool> needsReset(numberOfEnvironments, true);
+	ShmObservation observation;
+	bool lost = false;
+	bool silent = false;   // The server stopped answering
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	for (int64_t step = 0; step < steps && !lost && !silent; step++)
+	{
+		int k = (int)(step % numberOfEnvironments);
+		ShmChannel &ring = channel(region, k);
+		ShmRequest request;
+		request.kind = needsReset[k] ? ShmReset : ShmStep;
+		request.action = rng.nextBelow(NumberOfDirections);
+		request.sequence = (uint64_t)step;
+
+		std::chrono::steady_clock::time_point sent = std::chrono::steady_clock::now();
+		ring.requests.push(request);
+		int idlePolls = 0;
+		while (!ring.observations.pop(observation) && !silent)
+		{
+			waitForWork(idlePolls);
+			// Only look at the clock once spinning is over, to keep fast steps fast
+			silent = (idlePolls > SpinsBeforeYield && timedOut(sent));
+		}
+		if (silent)
+		{
+			break;
+		}
+		std::chrono::duration<double, std::micro> latency = std::chrono::steady_clock::now() - sent;
+		latencies.push_back(latency.count());
+
+		lost = (observation.sequence != request.sequence);
+		needsReset[k] = (observation.done != 0);
+		if (observation.done)
+		{
+			gamesFinished++;
+			totalScore += observation.score;
+		}
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	header->stopServer.store(1, std::memory_order_release);
+	munmap(region, size);
+
+	if (lost)
+	{
+		std::cout << "Observation out of sequence after " << latencies.size() << " steps." << std::endl;
+		return 1;
+	}
+	if (silent || latencies.empty())
+	{
+		std::cout << "The server on " << name << " stopped answering after " << latencies.size() << " steps." << std::endl;
+		return 1;
+	}
+	std::sort(latencies.begin(), latencies.end());
+	std::cout << std::fixed << std::setprecision(2)
+		<< "environments: " << numberOfEnvironments << "\n"
+		<< "steps: " << latencies.size() << "\n"
+		<< "seconds: " << std::setprecision(3) << elapsed.count() << "\n"
+		<< std::setprecision(1)
+		<< "steps_per_sec: " << latencies.size() / elapsed.count() << "\n"
+		<< std::setprecision(2)
+		<< "latency_us_p50: " << percentile(latencies, 0.50) << "\n"
+		<< "latency_us_p90: " << percentile(latencies, 0.90) << "\n"
+		<< "latency_us_p99: " << percentile(latencies, 0.99) << "\n"
+		<< "latency_us_max: " << latencies.back() << "\n"
+		<< "games_finished: " << gamesFinished << "\n"
+		<< std::setprecision(1)
+		<< "score_mean: " << (gamesFinished > 0 ? (double)totalScore / gamesFinished : 0.0) << "\n";
+	return 0;
+}
+
+#else
+
+//-------------------------------------------------------------------------------------
+// POSIX shared memory is not available on Windows
+int runShmServerCommand(int argc, char *argv[])
+{
+	std::cout << "The shared-memory server needs a POSIX system." << std::endl;
+	return 1;
+}
+
+int runShmClientCommand(int argc, char *argv[])
+{
+	std::cout << "The shared-memory server needs a POSIX system." << std::endl;
+	return 1;
+}
+
+#endif
@@ -0,0 +1,144 @@
+//  shmserver.h
+//     Environment server for trainers running as other processes on the same
+//     machine.  The server plays K games with no window and trades actions and
+//     observations with its client through a POSIX shared-memory region, with no
+//     system call per step: each game has a pair of lock-free single-producer,
+//     single-consumer rings, one carrying requests from the client and one carrying
+//     observations back.  Both sides poll their rings, spinning for a while before
+//     giving up the core, so a step takes microseconds rather than a socket round trip.
+//     A server idle for longer than that sleeps between polls, so it does not keep a
+//     core busy while no client steps.
+//
+//     The region, named /NAME, holds a ShmHeader followed by K ShmChannels.  A
+//     client maps it, waits for serverReady, then for each game pushes ShmRequests
+//     into requests and pops ShmObservations from observations, one observation per
+//     request, in order.  Setting stopServer asks the server to exit, which removes
+//     the region; so does an INT or TERM signal.  A region left behind by a server
+//     that was killed outright is found by the next server started with the same
+//     name, which removes it when the process recorded in it is gone.
+//
+//     Started from the command line with:
+//        1024 --shm-server NAME [--environments K] [--size S] [--seed X] [--threads T]
+//        1024 --shm-client NAME [--steps N]
+//     The second is a small stand-in client that plays random moves in every game,
+//     reports the step latency it saw, and then stops the server.  It gives up if the
+//     server is not ready, or stops answering, for ShmClientTimeoutMillis.
+
+#ifndef SHMSERVER_H
+#define SHMSERVER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include "board.h"
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "The rings need lock-free atomics to work across processes");
+
+const uint32_t ShmMagic = 0x534B3147;   // "G1KS"
+const uint32_t ShmVersion = 2;
+const int ShmRingCapacity = 16;         // Slots in each ring, a power of 2
+const int ShmCacheLine = 64;
+const int ShmClientTimeoutMillis = 5000;
+
+//-------------------------------------------------------------------------------------
+// Single-producer, single-consumer ring of Capacity slots.  The producer only writes
+// head and the consumer only writes tail, each on its own cache line, so the two
+// sides never write the same line except to hand over a slot.
+template<class T, int Capacity>
+struct SpscRing
+{
+	alignas(ShmCacheLine) std::atomic<uint32_t> head;   // Slots pushed so far
+	alignas(ShmCacheLine) std::atomic<uint32_t> tail;   // Slots popped so far
+	alignas(ShmCacheLine) T slots[Capacity];
+
+	void clear()
+	{
+		head.store(0, std::memory_order_relaxed);
+		tail.store(0, std::memory_order_relaxed);
+	}
+
+	// Producer side.  Returns false if the ring is full.
+	bool push(const T &item)
+	{
+		uint32_t h = head.load(std::memory_order_relaxed);
+		if (h - tail.load(std::memory_order_acquire) == (uint32_t)Capacity)
+		{
+			return false;
+		}
+		slots[h & (Capacity - 1)] = item;
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer side.  Returns false if the ring is empty.
+	bool pop(T &item)
+	{
+		uint32_t t = tail.load(std::memory_order_relaxed);
+		if (t == head.load(std::memory_order_acquire))
+		{
+			return false;
+		}
+		item = slots[t & (Capacity - 1)];
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+};
+
+// What a request asks for
+enum ShmRequestKind
+{
+	ShmStep,    // Make the move in action
+	ShmReset    // Start a new game
+};
+
+struct ShmRequest
+{
+	uint32_t kind;       // A ShmRequestKind
+	uint32_t action;     // Direction, for ShmStep
+	uint64_t sequence;   // Chosen by the client, handed back in the observation
+};
+
+struct ShmObservation
+{
+	uint64_t sequence;     // Of the request answered
+	int32_t reward;        // Points scored by the move
+	int32_t score;
+	int32_t moveNumber;
+	uint8_t moved;         // Whether the move changed the board
+	uint8_t done;          // Whether no move is left to make
+	uint8_t unused[2];
+	int32_t board[MaxBoardSize * MaxBoardSize];   // Row by row, squaresPerSide per row
+};
+
+struct ShmChannel
+{
+	SpscRing<ShmRequest, ShmRingCapacity> requests;           // Client to server
+	SpscRing<ShmObservation, ShmRingCapacity> observations;   // Server to client
+};
+
+struct ShmHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t numberOfEnvironments;
+	uint32_t squaresPerSide;
+	int32_t serverProcess;   // Process ID of the server, to tell a region left behind
+	alignas(ShmCacheLine) std::atomic<uint32_t> serverReady;
+	std::atomic<uint32_t> stopServer;
+};
+
+// Offset of environment k's channel in the region, and the size of a region for K
+inline size_t shmChannelOffset(int k)
+{
+	return (sizeof(ShmHeader) + ShmCacheLine - 1) / ShmCacheLine * ShmCacheLine + k * sizeof(ShmChannel);
+}
+
+inline size_t shmRegionSize(int numberOfEnvironments)
+{
+	return shmChannelOffset(numberOfEnvironments);
+}
+
+int runShmServerCommand(int argc, char *argv[]);
+int runShmClientCommand(int argc, char *argv[]);
+
+#endif // SHMSERVER_H
@@ -0,0 +1,405 @@
+//  simulation.cpp
+//     Headless batch mode.  See simulation.h.
+//
+//     Games are dealt out to the worker threads round-robin: worker t plays games
+//     t, t + T, t + 2T, ...  Every game has its own Game (and so its own random
+//     stream, derived from the seed and the game number), and a worker only writes the
+//     result slots of its own games, so the workers share no mutable state (apart from
+//     the replay file, which only ever gets whole games) and the results do not depend
+//     on the number of threads.  The expectimax policy searches with a transposition
+//     table of the worker's own, emptied before every game, so each move depends only
+//     on the game's own earlier searches.  The one exception is --eval-cache: a search
+//     then takes whatever result the file holds for its position, which may have been
+//     stored by another game, another thread or an earlier run, so with it the results
+//     can change from run to run.
+
+#include "simulation.h"
+#include "boardkernels.h"
+#include "bitboard.h"
+#include "expectimax.h"
+#include "montecarlo.h"
+#include "replay.h"
+#include "evalcache.h"
+#include "ntuple.h"
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+#include <cstdlib>
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <map>
+
+// Order in which the corner policy, and the fallback when a move does nothing, try directions
+static const Direction PreferredDirections[NumberOfDirections] = {
+	DirectionDown, DirectionLeft, DirectionRight, DirectionUp
+};
+
+
+//-------------------------------------------------------------------------------------
+// Direction that scores the most points right away, from all four moves made at
+// once.  Ties go to the earlier direction in PreferredDirections.
+static Direction chooseGreedyMove(const Game &game)
+{
+	AllMoves moves;
+	slideAllDirections(game.board, game.squaresPerSide, moves);
+	Direction best = PreferredDirections[0];
+	int bestGain = -1;
+	for (int i = 0; i < NumberOfDirections; i++)
+	{
+		Direction direction = PreferredDirections[i];
+		if (moves.changed[direction] && moves.gains[direction] > bestGain)
+		{
+			best = direction;
+			bestGain = moves.gains[direction];
+		}
+	}
+	return best;
+}
+
+//-------------------------------------------------------------------------------------
+// Direction the network rates best.  Boards it cannot rate (no network, not 4x4, or
+// a tile too large to pack) get the greedy move instead.
+static Direction chooseNetworkMove(const Game &game, const NTupleNetwork *network)
+{
+	Bitboard packed;
+	if (network != NULL && game.squaresPerSide == BitboardSide && packBoard(game.board, packed))
+	{
+		bool found;
+		Direction direction = chooseNTupleMove(*network, packed, found);
+		if (found)
+		{
+			return direction;
+		}
+	}
+	return chooseGreedyMove(game);
+}
+
+//-------------------------------------------------------------------------------------
+// The direction the policy would like to move next, searching with the given
+// settings (the defaults if NULL).  It may turn out not to change the board, in
+// which case playGame() falls back to the other directions.
+Direction chooseMove(MovePolicy policy, Game &game, const ExpectimaxConfig *search)
+{
+	switch (policy) {
+	case PolicyRandom:
+		return (Direction)game.rng.nextBelow(NumberOfDirections);
+	case PolicyGreedy:
+		return chooseGreedyMove(game);
+	case PolicyExpectimax:
+		return searchBestMove(game, (search != NULL) ? *search : ExpectimaxConfig()).bestMove;
+	case PolicyNTuple:
+		return chooseNetworkMove(game, (search != NULL) ? search->network : NULL);
+	case PolicyMonteCarlo:
+		return monteCarloBestMove(game).bestMove;
+	case PolicyCorner:
+	default:
+		return PreferredDirections[0];
+	}
+}
+
+//-------------------------------------------------------------------------------------
+// Play the game until no direction changes the board, or until maxMoves moves have
+// been made if maxMoves is not 0.  Every move is recorded in replay, if given, and
+// the expectimax and ntuple policies use the search settings, if given, with their
+// evaluation cache and network.  Returns the number of moves made.
+int64_t playGame(Game &game, MovePolicy policy, int64_t maxMoves, ReplayWriter *replay,
+	const ExpectimaxConfig *search)
+{
+	int64_t moves = 0;
+	while ((maxMoves == 0 || moves < maxMoves) && hasLegalMove(game))
+	{
+		// Some direction is known to work, so the fallback always finds one
+		Direction direction = chooseMove(policy, game, search);
+		bool moved = makeMove(game, direction);
+		for (int i = 0; !moved && i < NumberOfDirections; i++)
+		{
+			if (PreferredDirections[i] != direction)
+			{
+				direction = PreferredDirections[i];
+				moved = makeMove(game, direction);
+			}
+		}
+		if (replay != NULL)
+		{
+			replay->recordMove(direction, game);
+		}
+		moves++;
+	}
+	return moves;
+}
+
+//-------------------------------------------------------------------------------------
+// Worker thread: play every numberOfThreads-th game, starting with game firstGame.
+// Each finished game is appended to replayFile, if given, in a single write.
+static void playGames(const BatchConfig &config, int firstGame, int numberOfThreads,
+	FILE *replayFile, const ExpectimaxConfig &search, BatchResult &result, int64_t &moves)
+{
+	Game game;
+	ReplayWriter replay(replayFile);
+	ExpectimaxConfig gameSearch = search;
+	TranspositionTable *table = NULL;
+	if (config.policy == PolicyExpectimax)
+	{
+		table = new TranspositionTable;
+		gameSearch.table = table;
+	}
+	moves = 0;
+	for (int g = firstGame; g < config.numberOfGames; g += numberOfThreads)
+	{
+		newGame(game, config.squaresPerSide, config.seed, g);
+		if (table != NULL)
+		{
+			table->clear();   // Nothing from the worker's other games
+		}
+		if (replayFile != NULL)
+		{
+			replay.beginGame(game);
+			moves += playGame(game, config.policy, 0, &replay, &gameSearch);
+			replay.endGame(game);
+		}
+		else
+		{
+			moves += playGame(game, config.policy, 0, NULL, &gameSearch);
+		}
+		result.scores[g] = game.score;
+		result.maxTiles[g] = maxTileValue(game);
+	}
+	delete table;
+}
+
+//-------------------------------------------------------------------------------------
+// Number of worker threads a batch will use: one per core unless the config says
+// otherwise, and never more than there are games
+static int batchThreadCount(const BatchConfig &config)
+{
+	int numberOfThreads = config.numberOfThreads;
+	if (numberOfThreads <= 0)
+	{
+		numberOfThreads = std::max(1u, std::thread::hardware_concurrency());
+	}
+	return std::max(1, std::min(numberOfThreads, config.numberOfGames));
+}
+
+//-------------------------------------------------------------------------------------
+// Play config.numberOfGames games spread over the worker threads
+BatchResult runBatch(const BatchConfig &config)
+{
+	initializeBitboardTables();
+
+	int numberOfThreads = batchThreadCount(config);
+
+	BatchResult result;
+	result.scores.assign(config.numberOfGames, 0);
+	result.maxTiles.assign(config.numberOfGames, 0);
+	std::vector<int64_t> moves(numberOfThreads, 0);
+	FILE *replayFile = NULL;
+	if (config.replayPath != NULL)
+	{
+		replayFile = fopen(config.replayPath, "ab");
+		if (replayFile == NULL)
+		{
+			std::cout << "Unable to open " << config.replayPath << ", games will not be saved." << std::endl;
+		}
+	}
+
+	// Settings every thread's searches share
+	ExpectimaxConfig search;
+	search.network = config.network;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	EvaluationCache cache;
+	result.evalCacheStatus = EvalCacheUnavailable;
+	if (config.evalCachePath != NULL)
+	{
+		result.evalCacheStatus = cache.open(config.evalCachePath, config.squaresPerSide,
+			expectimaxFingerprint(search));
+	}
+	std::chrono::duration<double> opening = std::chrono::steady_clock::now() - start;
+	result.evalCacheOpenSeconds = opening.count();
+	search.cache = cache.isOpen() ? &cache : NULL;
+	std::vector<std::thread> workers;
+	for (int t = 0; t < numberOfThreads; t++)
+	{
+		workers.push_back(std::thread(playGames, std::cref(config), t, numberOfThreads,
+			replayFile, std::cref(search), std::ref(result), std::ref(moves[t])));
+	}
+	for (size_t t = 0; t < workers.size(); t++)
+	{
+		workers[t].join();
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	if (replayFile != NULL)
+	{
+		fclose(replayFile);
+	}
+
+	result.seconds = elapsed.count();
+	result.evalCacheHits = cache.getHits();
+	result.evalCacheMisses = cache.getMisses();
+	result.evalCacheStores = cache.getStores();
+	result.evalCacheEntries = cache.countEntries();
+	result.totalMoves = 0;
+	for (size_t t = 0; t < moves.size(); t++)
+	{
+		result.totalMoves += moves[t];
+	}
+	return result;
+}
+
+//-------------------------------------------------------------------------------------
+// Value at fraction p (0 to 1) of the way through a sorted list
+static int percentile(const std::vector<int> &sorted, double p)
+{
+	size_t index = (size_t)(p * (sorted.size() - 1) + 0.5);
+	return sorted[index];
+}
+
+//-------------------------------------------------------------------------------------
+// Display the speed and the distributions of scores and max tiles, one "name: value"
+// per line
+static void displayBatchReport(const BatchConfig &config, int numberOfThreads,
+	const BatchResult &result)
+{
+	std::vector<int> scores = result.scores;
+	std::sort(scores.begin(), scores.end());
+	double totalScore = 0;
+	for (size_t i = 0; i < scores.size(); i++)
+	{
+		totalScore += scores[i];
+	}
+
+	std::cout << std::fixed << std::setprecision(1)
+		<< "games: " << config.numberOfGames << "\n"
+		<< "board: " << config.squaresPerSide << "x" << config.squaresPerSide << "\n"
+		<< "threads: " << numberOfThreads << "\n"
+		<< "seed: " << config.seed << "\n"
+		<< "seconds: " << std::setprecision(3) << result.seconds << "\n"
+		<< std::setprecision(1)
+		<< "games_per_sec: " << config.numberOfGames / result.seconds << "\n"
+		<< "moves_per_sec: " << result.totalMoves / result.seconds << "\n"
+		<< "moves_total: " << result.totalMoves << "\n"
+		<< "score_mean: " << totalScore / scores.size() << "\n"
+		<< "score_min: " << scores.front() << "\n"
+		<< "score_p50: " << percentile(scores, 0.50) << "\n"
+		<< "score_p90: " << percentile(scores, 0.90) << "\n"
+		<< "score_p99: " << percentile(scores, 0.99) << "\n"
+		<< "score_max: " << scores.back() << "\n";
+
+	if (config.evalCachePath != NULL)
+	{
+		std::cout << "eval_cache: " << evalCacheStatusName(result.evalCacheStatus) << "\n"
+			<< "eval_cache_open_ms: " << std::setprecision(3) << 1000 * result.evalCacheOpenSeconds << "\n"
+			<< "eval_cache_hits: " << result.evalCacheHits << "\n"
+			<< "eval_cache_misses: " << result.evalCacheMisses << "\n"
+			<< "eval_cache_stores: " << result.evalCacheStores << "\n"
+			<< "eval_cache_entries: " << result.evalCacheEntries << "\n";
+	}
+
+	// How many games ended with each max tile
+	std::map<int, int> maxTileCounts;
+	for (size_t i = 0; i < result.maxTiles.size(); i++)
+	{
+		maxTileCounts[result.maxTiles[i]]++;
+	}
+	for (std::map<int, int>::iterator it = maxTileCounts.begin(); it != maxTileCounts.end(); ++it)
+	{
+		std::cout << "max_tile_" << it->first << ": " << it->second << " ("
+			<< 100.0 * it->second / config.numberOfGames << "%)\n";
+	}
+}
+
+//-------------------------------------------------------------------------------------
+static void displayBatchUsage()
+{
+	std::cout << "Usage: 1024 --batch [--games N] [--size S] [--seed X]\n"
+		<< "                   [--policy random|corner|greedy|expectimax|montecarlo|ntuple]\n"
+		<< "                   [--threads T] [--replay FILE] [--eval-cache FILE] [--network FILE]\n";
+}
+
+//-------------------------------------------------------------------------------------
+// Handle "--batch" on the command line.  Returns the program's exit status.
+int runBatchCommand(int argc, char *argv[])
+{
+	BatchConfig config;
+	config.numberOfGames = 1000;
+	config.squaresPerSide = 4;
+	config.seed = 1;
+	config.policy = PolicyRandom;
+	config.numberOfThreads = 0;
+	config.replayPath = NULL;
+	config.evalCachePath = NULL;
+	config.network = NULL;
+	const char *networkPath = NULL;
+
+	for (int i = 2; i < argc; i++)
+	{
+		const char *option = argv[i];
+		const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+		if (value == NULL)
+		{
+			displayBatchUsage();
+			return 1;
+		}
+		if (strcmp(option, "--games") == 0) {
+			config.numberOfGames = atoi(value);
+		}
+		else if (strcmp(option, "--size") == 0) {
+			config.squaresPerSide = atoi(value);
+		}
+		else if (strcmp(option, "--seed") == 0) {
+			config.seed = strtoull(value, NULL, 10);
+		}
+		else if (strcmp(option, "--threads") == 0) {
+			config.numberOfThreads = atoi(value);
+		}
+		else if (strcmp(option, "--replay") == 0) {
+			config.replayPath = value;
+		}
+		else if (strcmp(option, "--eval-cache") == 0) {
+			config.evalCachePath = value;
+		}
+		else if (strcmp(option, "--network") == 0) {
+			networkPath = value;
+		}
+		else if (strcmp(option, "--policy") == 0) {
+			if (strcmp(value, "random") == 0) config.policy = PolicyRandom;
+			else if (strcmp(value, "corner") == 0) config.policy = PolicyCorner;
+			else if (strcmp(value, "greedy") == 0) config.policy = PolicyGreedy;
+			else if (strcmp(value, "expectimax") == 0) config.policy = PolicyExpectimax;
+			else if (strcmp(value, "montecarlo") == 0) config.policy = PolicyMonteCarlo;
+			else if (strcmp(value, "ntuple") == 0) config.policy = PolicyNTuple;
+			else {
+				displayBatchUsage();
+				return 1;
+			}
+		}
+		else {
+			displayBatchUsage();
+			return 1;
+		}
+		i++;   // Skip over the value
+	}
+
+	if (config.numberOfGames < 1
+		|| config.squaresPerSide < MinBoardSize || config.squaresPerSide > MaxBoardSize
+		|| (config.policy == PolicyNTuple && networkPath == NULL))
+	{
+		displayBatchUsage();
+		return 1;
+	}
+	NTupleNetwork network;
+	if (networkPath != NULL)
+	{
+		if (!network.load(networkPath))
+		{
+			std::cout << networkPath << " is not a 1024 n-tuple network." << std::endl;
+			return 1;
+		}
+		config.network = &network;
+	}
+
+	BatchResult result = runBatch(config);
+	displayBatchReport(config, batchThreadCount(config), result);
+	return 0;
+}
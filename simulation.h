@@ -0,0 +1,72 @@
+//  simulation.h
+//     Headless batch mode: play many games with a fixed move policy on all cores and
+//     report how fast they ran and how well they scored.
+//
+//     Started from the command line with:
+//        1024 --batch [--games N] [--size S] [--seed X] [--policy P] [--threads T]
+//                     [--replay FILE] [--eval-cache FILE] [--network FILE]
+//     where P is one of random, corner, greedy, expectimax, montecarlo or ntuple.  With
+//     --replay every game is appended to FILE, see replay.h.  With --eval-cache the
+//     expectimax policy keeps its results in FILE from one run to the next, see
+//     evalcache.h.  --network loads a network trained with --train (see ntuple.h),
+//     which the ntuple policy needs and the expectimax policy then evaluates with.
+
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "game.h"
+#include "evalcache.h"
+
+class ReplayWriter;
+class NTupleNetwork;
+struct ExpectimaxConfig;
+
+// How the simulated player picks its moves
+enum MovePolicy
+{
+	PolicyRandom,   // Any direction, uniformly at random
+	PolicyCorner,   // Prefer down, then left, then right, then up, to keep tiles in a corner
+	PolicyGreedy,   // The direction that scores the most points right away
+	PolicyExpectimax,  // The direction with the best expected value, see expectimax.h
+	PolicyMonteCarlo,  // The direction with the best random rollouts, see montecarlo.h
+	PolicyNTuple       // The direction the n-tuple network rates best, see ntuple.h
+};
+
+struct BatchConfig
+{
+	int numberOfGames;
+	int squaresPerSide;
+	uint64_t seed;
+	MovePolicy policy;
+	int numberOfThreads;   // 0 means one per core
+	const char *replayPath;   // File to append the games to, or NULL
+	const char *evalCachePath;   // Evaluation cache file for the expectimax policy, or NULL
+	const NTupleNetwork *network;   // Network for the ntuple and expectimax policies, or NULL
+};
+
+struct BatchResult
+{
+	int64_t totalMoves;
+	double seconds;               // Wall-clock time for the whole batch
+	std::vector<int> scores;      // Final score of each game, in game order
+	std::vector<int> maxTiles;    // Largest tile of each game, in game order
+
+	// How the evaluation cache file opened, if one was given, and how it was used
+	EvalCacheStatus evalCacheStatus;
+	double evalCacheOpenSeconds;
+	int64_t evalCacheHits;
+	int64_t evalCacheMisses;
+	int64_t evalCacheStores;
+	int64_t evalCacheEntries;     // Entries in the file after the batch
+};
+
+Direction chooseMove(MovePolicy policy, Game &game, const ExpectimaxConfig *search = NULL);
+int64_t playGame(Game &game, MovePolicy policy, int64_t maxMoves = 0, ReplayWriter *replay = NULL,
+	const ExpectimaxConfig *search = NULL);
+BatchResult runBatch(const BatchConfig &config);
+int runBatchCommand(int argc, char *argv[]);
+
+#endif // SIMULATION_H
@@ -0,0 +1,170 @@
+//  threadpool.cpp
+//     Work-stealing thread pool.  See threadpool.h.
+
+#include "threadpool.h"
+
+// The pool and queue index of the worker running on this thread, if any
+static thread_local WorkStealingPool *currentPool = NULL;
+static thread_local int currentQueue = -1;
+
+
+//-------------------------------------------------------------------------------------
+// Queue a task in the group
+void TaskGroup::run(const std::function<void()> &task)
+{
+	pending++;
+	WorkStealingPool::Task queued = { task, this };
+	pool.submit(queued);
+}
+
+//-------------------------------------------------------------------------------------
+// Wait for every task of the group to finish, running queued tasks in the meantime
+void TaskGroup::wait()
+{
+	int ownQueue = (currentPool == &pool) ? currentQueue : -1;
+	while (pending.load() > 0)
+	{
+		if (!pool.runOneTask(ownQueue))
+		{
+			std::this_thread::yield();   // The remaining tasks are running on other threads
+		}
+	}
+}
+
+
+//-------------------------------------------------------------------------------------
+// Start the workers; numberOfThreads of 0 means one per core
+WorkStealingPool::WorkStealingPool(int numberOfThreads)
+	: nextQueue(0), queuedTasks(0), stopping(false)
+{
+	if (numberOfThreads <= 0)
+	{
+		numberOfThreads = (int)std::thread::hardware_concurrency();
+		if (numberOfThreads <= 0)
+		{
+			numberOfThreads = 1;
+		}
+	}
+	for (int i = 0; i < numberOfThreads; i++)
+	{
+		queues.push_back(new WorkerQueue);
+	}
+	for (int i = 0; i < numberOfThreads; i++)
+	{
+		workers.push_back(std::thread(&WorkStealingPool::workerLoop, this, i));
+	}
+}
+
+//-------------------------------------------------------------------------------------
+WorkStealingPool::~WorkStealingPool()
+{
+	{
+		std::lock_guard<std::mutex> guard(sleepLock);
+		stopping = true;
+	}
+	wakeUp.notify_all();
+	for (size_t i = 0; i < workers.size(); i++)
+	{
+		workers[i].join();
+	}
+	for (size_t i = 0; i < queues.size(); i++)
+	{
+		delete queues[i];
+	}
+}
+
+//-------------------------------------------------------------------------------------
+WorkStealingPool &WorkStealingPool::shared()
+{
+	static WorkStealingPool pool;
+	return pool;
+}
+
+//-------------------------------------------------------------------------------------
+// Tasks submitted by a worker go on its own queue, where it will find them first.
+// Tasks from outside the pool are dealt out to the queues in turn.
+void WorkStealingPool::submit(const Task &task)
+{
+	int index = (currentPool == this) ? currentQueue : (int)(nextQueue++ % queues.size());
+	{
+		std::lock_guard<std::mutex> guard(queues[index]->lock);
+		queues[index]->tasks.push_back(task);
+	}
+	{
+		std::lock_guard<std::mutex> guard(sleepLock);
+		queuedTasks++;
+	}
+	wakeUp.notify_one();
+}
+
+//-------------------------------------------------------------------------------------
+// Take the newest task from the preferred queue, or failing that steal the oldest
+// task from another queue.  preferredQueue is -1 for a thread outside the pool.
+bool WorkStealingPool::takeTask(int preferredQueue, Task &task)
+{
+	int numberOfQueues = (int)queues.size();
+	if (preferredQueue >= 0)
+	{
+		WorkerQueue &own = *queues[preferredQueue];
+		std::lock_guard<std::mutex> guard(own.lock);
+		if (!own.tasks.empty())
+		{
+			task = own.tasks.back();
+			own.tasks.pop_back();
+			queuedTasks--;
+			return true;
+		}
+	}
+	for (int i = 1; i <= numberOfQueues; i++)
+	{
+		int victim = (preferredQueue + i + numberOfQueues) % numberOfQueues;
+		if (victim == preferredQueue)
+		{
+			continue;
+		}
+		WorkerQueue &other = *queues[victim];
+		std::lock_guard<std::mutex> guard(other.lock);
+		if (!other.tasks.empty())
+		{
+			task = other.tasks.front();
+			other.tasks.pop_front();
+			queuedTasks--;
+			return true;
+		}
+	}
+	return false;
+}
+
+//-------------------------------------------------------------------------------------
+// Run one queued task, if there is one.  Returns false if every queue was empty.
+bool WorkStealingPool::runOneTask(int preferredQueue)
+{
+	Task task;
+	if (!takeTask(preferredQueue, task))
+	{
+		return false;
+	}
+	task.function();
+	task.group->pending--;
+	return true;
+}
+
+//-------------------------------------------------------------------------------------
+void WorkStealingPool::workerLoop(int index)
+{
+	currentPool = this;
+	currentQueue = index;
+	while (true)
+	{
+		if (runOneTask(index))
+		{
+			continue;
+		}
+		std::unique_lock<std::mutex> guard(sleepLock);
+		wakeUp.wait(guard, [this] { return stopping || queuedTasks.load() > 0; });
+		if (stopping && queuedTasks.load() == 0)
+		{
+			return;
+		}
+	}
+}
@@ -0,0 +1,83 @@
+//  threadpool.h
+//     Work-stealing thread pool.  Every worker has its own deque of tasks: it takes
+//     work from the back of its own deque, and when that is empty it steals from the
+//     front of the others', so one long-running task never leaves the rest of the
+//     work stuck behind it on an otherwise idle core.
+//
+//     Tasks are submitted as part of a TaskGroup.  TaskGroup::wait() runs pending
+//     tasks itself while it waits, so a task may submit and wait for more work
+//     without tying up a worker.
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class WorkStealingPool;
+
+//-------------------------------------------------------------------------------------
+// Set of tasks that can be waited on together
+class TaskGroup
+{
+public:
+	explicit TaskGroup(WorkStealingPool &pool) : pool(pool), pending(0) { }
+	~TaskGroup() { wait(); }
+
+	void run(const std::function<void()> &task);
+	void wait();
+
+private:
+	friend class WorkStealingPool;
+
+	WorkStealingPool &pool;
+	std::atomic<int> pending;   // Tasks submitted but not yet finished
+};
+
+//-------------------------------------------------------------------------------------
+class WorkStealingPool
+{
+public:
+	explicit WorkStealingPool(int numberOfThreads = 0);
+	~WorkStealingPool();
+
+	int getNumberOfThreads() const { return (int)workers.size(); }
+
+	// The pool shared by everything in the program, with one worker per core
+	static WorkStealingPool &shared();
+
+private:
+	friend class TaskGroup;
+
+	struct Task
+	{
+		std::function<void()> function;
+		TaskGroup *group;
+	};
+
+	struct WorkerQueue
+	{
+		std::mutex lock;
+		std::deque<Task> tasks;
+	};
+
+	void submit(const Task &task);
+	bool runOneTask(int preferredQueue);
+	bool takeTask(int preferredQueue, Task &task);
+	void workerLoop(int index);
+
+	std::vector<std::thread> workers;
+	std::vector<WorkerQueue *> queues;
+	std::atomic<unsigned> nextQueue;    // Round-robin queue for tasks submitted from outside the pool
+	std::atomic<int> queuedTasks;       // Tasks sitting in some queue
+	std::mutex sleepLock;               // Idle workers wait on wakeUp under this lock
+	std::condition_variable wakeUp;
+	bool stopping;
+};
+
+#endif // THREADPOOL_H
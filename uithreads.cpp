@@ -0,0 +1,82 @@
+//  uithreads.cpp
+//     Hand-offs between the threads of the interactive game.  See uithreads.h.
+
+#include "uithreads.h"
+#include <cstring>
+
+
+//-------------------------------------------------------------------------------------
+void CommandQueue::push(char key, int first, int second)
+{
+	UserCommand command = { key, first, second };
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		commands.push_back(command);
+	}
+	ready.notify_one();
+}
+
+//-------------------------------------------------------------------------------------
+UserCommand CommandQueue::pop()
+{
+	std::unique_lock<std::mutex> guard(lock);
+	while (commands.empty())
+	{
+		ready.wait(guard);
+	}
+	UserCommand command = commands.front();
+	commands.pop_front();
+	return command;
+}
+
+
+//-------------------------------------------------------------------------------------
+SnapshotHandoff::SnapshotHandoff()
+	: backSlot(0), published(0), frontSlot(1), middleSlot(2)
+{
+	memset(slots, 0, sizeof(slots));
+}
+
+//-------------------------------------------------------------------------------------
+// Hand the back snapshot over and take the old middle one to write next.  The release
+// makes the whole snapshot visible to the reader before the slot is.
+void SnapshotHandoff::publish()
+{
+	int previous = middleSlot.exchange(backSlot | FreshBit, std::memory_order_acq_rel);
+	backSlot = previous & ~FreshBit;
+}
+
+//-------------------------------------------------------------------------------------
+// Publish the game's board, and the trace of the move that led to it if there was one
+void SnapshotHandoff::publish(const Game &game, const MoveTrace *trace, bool finished)
+{
+	BoardSnapshot &snapshot = back();
+	int squares = game.squaresPerSide * game.squaresPerSide;
+	memcpy(snapshot.board, game.board, squares * sizeof(int));
+	snapshot.squaresPerSide = game.squaresPerSide;
+	snapshot.score = game.score;
+	snapshot.moveNumber = game.moveNumber;
+	snapshot.finished = finished;
+	snapshot.serial = ++published;
+	snapshot.trace.count = 0;
+	if (trace != NULL)
+	{
+		snapshot.trace.count = trace->count;
+		memcpy(snapshot.trace.moves, trace->moves, trace->count * sizeof(TileMove));
+	}
+	snapshot.spawnSquare = game.lastSpawnSquare;
+	publish();
+}
+
+//-------------------------------------------------------------------------------------
+// Take the middle snapshot if a new one has been published since the last call,
+// giving back the front one for the writer to reuse
+const BoardSnapshot &SnapshotHandoff::latest()
+{
+	if (middleSlot.load(std::memory_order_relaxed) & FreshBit)
+	{
+		int previous = middleSlot.exchange(frontSlot, std::memory_order_acq_rel);
+		frontSlot = previous & ~FreshBit;
+	}
+	return slots[frontSlot];
+}
@@ -0,0 +1,88 @@
+//  uithreads.h
+//     Hand-offs between the threads of the interactive game.  The window runs its own
+//     render thread, drawing frames at a fixed rate and handling key presses as they
+//     arrive, while the game itself is played on an engine thread that takes commands
+//     from both the window and the console.
+//
+//     Commands go to the engine through a CommandQueue.  Boards come back through a
+//     SnapshotHandoff, a triple buffer: the engine fills a snapshot no one else is
+//     looking at and swaps it in with one atomic exchange, and the render thread takes
+//     the newest one with another, so neither side ever waits on the other and the
+//     render thread never sees a snapshot that is still being written.
+
+#ifndef UITHREADS_H
+#define UITHREADS_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include "board.h"
+#include "boardkernels.h"
+#include "game.h"
+
+//-------------------------------------------------------------------------------------
+// One command for the engine: the console key, and the numbers that follow 'p'
+// (square and value), 'j' (line and move) and 'r' (board size, 0 for the same size)
+struct UserCommand
+{
+	char key;
+	int first;
+	int second;
+};
+
+//-------------------------------------------------------------------------------------
+// Commands from any number of threads, taken in order by the engine thread
+class CommandQueue
+{
+public:
+	void push(char key, int first = 0, int second = 0);
+	UserCommand pop();   // Waits until there is a command
+
+private:
+	std::mutex lock;
+	std::condition_variable ready;
+	std::deque<UserCommand> commands;
+};
+
+//-------------------------------------------------------------------------------------
+// Everything the window shows about the game at one moment
+struct BoardSnapshot
+{
+	int board[MaxBoardSize * MaxBoardSize];
+	int squaresPerSide;   // 0 until the engine publishes its first snapshot
+	int score;
+	int moveNumber;
+	bool finished;        // The game is over and the window should close
+	unsigned serial;      // Counts the snapshots published, to tell a new one from the last
+	MoveTrace trace;      // Where the tiles went in the move that led here, empty if none did
+	int spawnSquare;      // Square of the piece placed after that move
+};
+
+//-------------------------------------------------------------------------------------
+// Triple buffer of snapshots, with one writer and one reader
+class SnapshotHandoff
+{
+public:
+	SnapshotHandoff();
+
+	// Writer side: fill in the snapshot from back(), then publish() it
+	BoardSnapshot &back() { return slots[backSlot]; }
+	void publish();
+	void publish(const Game &game, const MoveTrace *trace = NULL, bool finished = false);
+
+	// Reader side: the newest snapshot published, which stays unchanged until the
+	// next call
+	const BoardSnapshot &latest();
+
+private:
+	static const int FreshBit = 4;   // Set in middleSlot when it holds a snapshot not yet read
+
+	BoardSnapshot slots[3];
+	int backSlot;                 // Written by the writer only
+	unsigned published;           // Snapshots published so far, kept by the writer
+	int frontSlot;                // Read by the reader only
+	std::atomic<int> middleSlot;  // The slot being handed over, plus FreshBit
+};
+
+#endif // UITHREADS_H
@@ -0,0 +1,222 @@
+//  zobrist.cpp
+//     Symmetry-canonical Zobrist hashing.  See zobrist.h.
+
+#include "zobrist.h"
+#include "gamerng.h"
+#include <mutex>
+
+const uint64_t ZobristSeed = 1024;   // Fixed, so hashes are the same from run to run
+
+// Key of a tile with exponent e on square i: ZobristKeys[i][e], 0 for an empty square
+static uint64_t ZobristKeys[MaxBoardSize * MaxBoardSize][ZobristExponents];
+
+// Key mixed into every hash of a board with n squares per side, so boards of
+// different sizes never share a hash
+static uint64_t SizeKeys[MaxBoardSize + 1];
+
+// PackedByteKeys[j][v]: the keys of the two tiles in byte j of a packed 4x4 board,
+// squares 2j and 2j + 1, when the byte is v
+static uint64_t PackedByteKeys[8][256];
+
+// SymmetricSquares[n - MinBoardSize][i][s]: where square i of an n x n board is when
+// the board is seen through symmetry s
+static uint8_t SymmetricSquares[MaxBoardSize - MinBoardSize + 1][MaxBoardSize * MaxBoardSize][NumberOfSymmetries];
+
+
+//-------------------------------------------------------------------------------------
+static void buildTables()
+{
+	GameRng rng(ZobristSeed, 0);
+	for (int square = 0; square < MaxBoardSize * MaxBoardSize; square++)
+	{
+		ZobristKeys[square][0] = 0;
+		for (int exponent = 1; exponent < ZobristExponents; exponent++)
+		{
+			ZobristKeys[square][exponent] = rng.next();
+		}
+	}
+	for (int size = 0; size <= MaxBoardSize; size++)
+	{
+		SizeKeys[size] = rng.next();
+	}
+	for (int byte = 0; byte < 8; byte++)
+	{
+		for (int bits = 0; bits < 256; bits++)
+		{
+			PackedByteKeys[byte][bits] = ZobristKeys[2 * byte][bits & 0xF] ^ ZobristKeys[2 * byte + 1][bits >> 4];
+		}
+	}
+	for (int size = MinBoardSize; size <= MaxBoardSize; size++)
+	{
+		for (int square = 0; square < size * size; square++)
+		{
+			for (int symmetry = 0; symmetry < NumberOfSymmetries; symmetry++)
+			{
+				SymmetricSquares[size - MinBoardSize][square][symmetry] =
+					(uint8_t)symmetricSquare(symmetry, square, size);
+			}
+		}
+	}
+}
+
+//-------------------------------------------------------------------------------------
+void initializeZobristTables()
+{
+	static std::once_flag tablesBuilt;
+	std::call_once(tablesBuilt, buildTables);
+}
+
+//-------------------------------------------------------------------------------------
+// Where the given square is when the board is seen through the symmetry
+int symmetricSquare(int symmetry, int square, int squaresPerSide)
+{
+	int row = square / squaresPerSide;
+	int col = square % squaresPerSide;
+	if (symmetry & 4)
+	{
+		int swap = row;
+		row = col;
+		col = swap;
+	}
+	if (symmetry & 1)
+	{
+		col = squaresPerSide - 1 - col;
+	}
+	if (symmetry & 2)
+	{
+		row = squaresPerSide - 1 - row;
+	}
+	return row * squaresPerSide + col;
+}
+
+//-------------------------------------------------------------------------------------
+static Direction transposeDirection(Direction direction)
+{
+	switch (direction) {
+	case DirectionLeft:  return DirectionUp;
+	case DirectionRight: return DirectionDown;
+	case DirectionUp:    return DirectionLeft;
+	default:             return DirectionRight;
+	}
+}
+
+//-------------------------------------------------------------------------------------
+static Direction mirrorColumnsDirection(Direction direction)
+{
+	return (direction == DirectionLeft) ? DirectionRight
+		: (direction == DirectionRight) ? DirectionLeft : direction;
+}
+
+//-------------------------------------------------------------------------------------
+static Direction mirrorRowsDirection(Direction direction)
+{
+	return (direction == DirectionUp) ? DirectionDown
+		: (direction == DirectionDown) ? DirectionUp : direction;
+}
+
+//-------------------------------------------------------------------------------------
+// The move on the board seen through the symmetry that matches the given move on
+// the board itself
+Direction symmetricDirection(int symmetry, Direction direction)
+{
+	if (symmetry & 4)
+	{
+		direction = transposeDirection(direction);
+	}
+	if (symmetry & 1)
+	{
+		direction = mirrorColumnsDirection(direction);
+	}
+	if (symmetry & 2)
+	{
+		direction = mirrorRowsDirection(direction);
+	}
+	return direction;
+}
+
+//-------------------------------------------------------------------------------------
+// The move on the board itself that matches the given move on the board seen
+// through the symmetry: symmetricDirection() undone, step by step in reverse
+Direction originalDirection(int symmetry, Direction direction)
+{
+	if (symmetry & 2)
+	{
+		direction = mirrorRowsDirection(direction);
+	}
+	if (symmetry & 1)
+	{
+		direction = mirrorColumnsDirection(direction);
+	}
+	if (symmetry & 4)
+	{
+		direction = transposeDirection(direction);
+	}
+	return direction;
+}
+
+//-------------------------------------------------------------------------------------
+// The smallest of the 8 hashes, and the symmetry it came from
+static CanonicalHash smallestHash(const uint64_t hashes[], int squaresPerSide)
+{
+	CanonicalHash result = { hashes[0], 0 };
+	for (int symmetry = 1; symmetry < NumberOfSymmetries; symmetry++)
+	{
+		if (hashes[symmetry] < result.hash)
+		{
+			result.hash = hashes[symmetry];
+			result.symmetry = symmetry;
+		}
+	}
+	result.hash ^= SizeKeys[squaresPerSide];
+	return result;
+}
+
+//-------------------------------------------------------------------------------------
+// Hash of an int board, the same for all 8 of its symmetries.  Values that are not
+// powers of two (placed with 'p') hash as the power of two below them.
+CanonicalHash canonicalHash(const int board[], int squaresPerSide)
+{
+	const uint8_t (*symmetric)[NumberOfSymmetries] = SymmetricSquares[squaresPerSide - MinBoardSize];
+	uint64_t hashes[NumberOfSymmetries] = { 0 };
+	for (int i = 0; i < squaresPerSide * squaresPerSide; i++)
+	{
+		if (board[i] > 0)
+		{
+			int exponent = highestSetBit((uint32_t)board[i]);
+			for (int symmetry = 0; symmetry < NumberOfSymmetries; symmetry++)
+			{
+				hashes[symmetry] ^= ZobristKeys[symmetric[i][symmetry]][exponent];
+			}
+		}
+	}
+	return smallestHash(hashes, squaresPerSide);
+}
+
+//-------------------------------------------------------------------------------------
+// Hash of a packed 4x4 board, the same for all 8 of its symmetries.  Rather than
+// hash all 8, which costs far more than the search's other work on a packed board,
+// this turns the board with bit operations, keeps whichever of the 8 is the
+// smallest number, and hashes just that one.  So the hash differs from the one
+// canonicalHash() gives the same board as ints, and a table holding both kinds of
+// board keeps such a position twice.
+CanonicalHash canonicalHash(Bitboard board)
+{
+	Bitboard turned[NumberOfSymmetries];
+	bitboardSymmetries(board, turned);
+
+	CanonicalHash result = { 0, 0 };
+	Bitboard smallest = board;
+	for (int symmetry = 1; symmetry < NumberOfSymmetries; symmetry++)
+	{
+		bool smaller = turned[symmetry] < smallest;
+		smallest = smaller ? turned[symmetry] : smallest;
+		result.symmetry = smaller ? symmetry : result.symmetry;
+	}
+
+	result.hash = SizeKeys[BitboardSide];
+	for (int byte = 0; byte < 8; byte++)
+	{
+		result.hash ^= PackedByteKeys[byte][(smallest >> (8 * byte)) & 0xFF];
+	}
+	return result;
+}
@@ -0,0 +1,41 @@
+//  zobrist.h
+//     Zobrist hashing of boards up to MaxBoardSize x MaxBoardSize, giving the same
+//     hash for a board and each of its rotations and reflections.
+//
+//     Every square and tile exponent has a random 64-bit key, and a board hashes to
+//     the XOR of the keys of its tiles.  The game plays the same on any of the 8
+//     symmetries of a square board, once the moves are turned with it, so a search
+//     can treat all 8 as one position.  canonicalHash() hashes the board as seen
+//     through each symmetry at once and keeps the smallest hash, along with which
+//     symmetry gave it; for a packed 4x4 board it instead keeps the smallest of the 8
+//     turned bitboards and hashes only that.  A move d on the board is the move
+//     symmetricDirection(symmetry, d) on the board seen through the symmetry, and
+//     originalDirection() turns it back.
+//
+//     Symmetry s transposes the board if bit 2 is set, then mirrors the columns if
+//     bit 0 is set and the rows if bit 1 is set.  Symmetry 0 leaves the board as it is.
+
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+#include <cstdint>
+#include "board.h"
+#include "bitboard.h"
+
+const int NumberOfSymmetries = 8;
+const int ZobristExponents = 32;   // Tile exponents 0 to 31, all an int board can hold
+
+struct CanonicalHash
+{
+	uint64_t hash;       // Smallest hash over the 8 symmetries
+	int symmetry;        // Symmetry the board was seen through to give it
+};
+
+void initializeZobristTables();
+int symmetricSquare(int symmetry, int square, int squaresPerSide);
+Direction symmetricDirection(int symmetry, Direction direction);
+Direction originalDirection(int symmetry, Direction direction);
+CanonicalHash canonicalHash(const int board[], int squaresPerSide);
+CanonicalHash canonicalHash(Bitboard board);
+
+#endif // ZOBRIST_H